@@ -0,0 +1,188 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+void DescriptorLayoutCache::init(VkDevice device) {
+    this->device = device;
+}
+
+void DescriptorLayoutCache::cleanup() {
+    for (auto& pair : layoutCache)
+        vkDestroyDescriptorSetLayout(device, pair.second, nullptr);
+    layoutCache.clear();
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::createDescriptorLayout(const VkDescriptorSetLayoutCreateInfo* info) {
+    DescriptorLayoutInfo layoutInfo;
+    layoutInfo.flags = info->flags;
+    layoutInfo.bindings.assign(info->pBindings, info->pBindings + info->bindingCount);
+
+    // order of bindings in create info doesn't matter, so normalize it before looking up
+    std::sort(layoutInfo.bindings.begin(), layoutInfo.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+        return a.binding < b.binding;
+    });
+
+    // samplers are compared by handle, caller's array doesn't outlive this call; they're ignored for other types
+    layoutInfo.immutableSamplers.resize(layoutInfo.bindings.size());
+    for (size_t i=0; i<layoutInfo.bindings.size(); ++i) {
+        VkDescriptorSetLayoutBinding& binding = layoutInfo.bindings[i];
+        const bool isSampler = binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER || binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        if (isSampler && binding.pImmutableSamplers != nullptr)
+            layoutInfo.immutableSamplers[i].assign(binding.pImmutableSamplers, binding.pImmutableSamplers + binding.descriptorCount);
+        binding.pImmutableSamplers = nullptr;
+    }
+
+    auto it = layoutCache.find(layoutInfo);
+    if (it != layoutCache.end())
+        return it->second;
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(device, info, nullptr, &layout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create descriptor set layout!");
+
+    layoutCache[layoutInfo] = layout;
+    return layout;
+}
+
+bool DescriptorLayoutCache::DescriptorLayoutInfo::operator==(const DescriptorLayoutInfo& other) const {
+    if (other.flags != flags || other.bindings.size() != bindings.size() || other.immutableSamplers != immutableSamplers)
+        return false;
+
+    for (size_t i=0; i<bindings.size(); ++i) {
+        if (other.bindings[i].binding != bindings[i].binding ||
+            other.bindings[i].descriptorType != bindings[i].descriptorType ||
+            other.bindings[i].descriptorCount != bindings[i].descriptorCount ||
+            other.bindings[i].stageFlags != bindings[i].stageFlags) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t DescriptorLayoutCache::DescriptorLayoutInfo::hash() const {
+    size_t result = std::hash<size_t>()(bindings.size());
+    result ^= std::hash<uint32_t>()(flags) + 0x9e3779b9 + (result << 6) + (result >> 2);
+
+    for (size_t i=0; i<bindings.size(); ++i) {
+        // pack binding into 64 bits, then mix it in the same way as boost::hash_combine
+        const VkDescriptorSetLayoutBinding& b = bindings[i];
+        uint64_t bindingHash = static_cast<uint64_t>(b.binding) | (static_cast<uint64_t>(b.descriptorType) << 8) | (static_cast<uint64_t>(b.descriptorCount) << 16) | (static_cast<uint64_t>(b.stageFlags) << 32);
+        result ^= std::hash<uint64_t>()(bindingHash) + 0x9e3779b9 + (result << 6) + (result >> 2);
+        for (VkSampler sampler : immutableSamplers[i])
+            result ^= std::hash<VkSampler>()(sampler) + 0x9e3779b9 + (result << 6) + (result >> 2);
+    }
+    return result;
+}
+
+void DescriptorAllocator::init(VkDevice device, uint32_t initialSetsPerPool) {
+    this->device = device;
+    setsPerPool = initialSetsPerPool;
+}
+
+void DescriptorAllocator::cleanup() {
+    for (VkDescriptorPool pool : freePools)
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    for (VkDescriptorPool pool : usedPools)
+        vkDestroyDescriptorPool(device, pool, nullptr);
+
+    freePools.clear();
+    usedPools.clear();
+    currentPool = VK_NULL_HANDLE;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+    if (currentPool == VK_NULL_HANDLE) {
+        currentPool = grabPool();
+        usedPools.push_back(currentPool);
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = currentPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet set;
+    VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+
+    // current pool is exhausted, chain a new pool and try once more
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        ++stats.poolOverflows;
+        currentPool = grabPool();
+        usedPools.push_back(currentPool);
+
+        allocInfo.descriptorPool = currentPool;
+        result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+    }
+
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate descriptor sets!");
+
+    ++stats.setsAllocated;
+    ++stats.totalSetsAllocated;
+    stats.poolsInUse = static_cast<uint32_t>(usedPools.size());
+    stats.poolsFree = static_cast<uint32_t>(freePools.size());
+    return set;
+}
+
+void DescriptorAllocator::resetPools() {
+    for (VkDescriptorPool pool : usedPools) {
+        vkResetDescriptorPool(device, pool, 0);
+        freePools.push_back(pool);
+    }
+    usedPools.clear();
+    currentPool = VK_NULL_HANDLE;
+
+    ++stats.resets;
+    stats.setsAllocated = 0;
+    stats.poolsInUse = 0;
+    stats.poolsFree = static_cast<uint32_t>(freePools.size());
+}
+
+void DescriptorAllocator::printStats(const char* name) const {
+    std::cout << "Descriptor allocator [" << name << "]\n";
+    std::cout << "  Pools created: " << stats.poolsCreated << " (in use: " << stats.poolsInUse << ", free: " << stats.poolsFree << ")\n";
+    std::cout << "  Pool overflows: " << stats.poolOverflows << '\n';
+    std::cout << "  Resets: " << stats.resets << '\n';
+    std::cout << "  Sets allocated: " << stats.setsAllocated << " (lifetime: " << stats.totalSetsAllocated << ")\n";
+}
+
+VkDescriptorPool DescriptorAllocator::grabPool() {
+    // prefer recycling an already reset pool
+    if (!freePools.empty()) {
+        VkDescriptorPool pool = freePools.back();
+        freePools.pop_back();
+        return pool;
+    }
+
+    VkDescriptorPool pool = createPool(setsPerPool);
+    // grow geometrically so a large number of sets don't cause a storm of small pools
+    setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+    return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount) {
+    std::vector<VkDescriptorPoolSize> sizes;
+    sizes.reserve(poolSizes.sizes.size());
+    for (const auto& sz : poolSizes.sizes) {
+        uint32_t count = static_cast<uint32_t>(sz.second * setCount);
+        sizes.push_back({ sz.first, std::max(count, 1u) });
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = 0;
+    poolInfo.maxSets = setCount;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(sizes.size());
+    poolInfo.pPoolSizes = sizes.data();
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create descriptor pool!");
+
+    ++stats.poolsCreated;
+    return pool;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * Caches descriptor set layouts by their flags, bindings, and immutable samplers, so requesting
+ * the same set of bindings twice returns the same VkDescriptorSetLayout.
+ */
+class DescriptorLayoutCache {
+public:
+    void init(VkDevice device);
+    void cleanup();
+
+    VkDescriptorSetLayout createDescriptorLayout(const VkDescriptorSetLayoutCreateInfo* info);
+
+    size_t getNumCachedLayouts() const { return layoutCache.size(); }
+
+private:
+    struct DescriptorLayoutInfo {
+        VkDescriptorSetLayoutCreateFlags flags = 0;
+        // bindings are kept sorted by binding index, pImmutableSamplers is copied out into immutableSamplers
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        std::vector<std::vector<VkSampler>> immutableSamplers;     // per binding, empty if it has none
+
+        bool operator==(const DescriptorLayoutInfo& other) const;
+        size_t hash() const;
+    };
+
+    struct DescriptorLayoutHash {
+        size_t operator()(const DescriptorLayoutInfo& k) const {
+            return k.hash();
+        }
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    std::unordered_map<DescriptorLayoutInfo, VkDescriptorSetLayout, DescriptorLayoutHash> layoutCache;
+};
+
+/*
+ * Growable descriptor set allocator.
+ * Allocates from the current pool, and chains a new (larger) pool whenever
+ * the current one reports VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL.
+ * resetPools() resets every pool wholesale and recycles them for later allocations,
+ * individual sets are never freed.
+ */
+class DescriptorAllocator {
+public:
+    struct PoolSizes {
+        // multiplier of sets per pool for each descriptor type
+        std::vector<std::pair<VkDescriptorType, float>> sizes = {
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0.5f },
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0.5f }
+        };
+    };
+
+    struct Stats {
+        uint32_t poolsCreated = 0;
+        uint32_t poolsInUse = 0;
+        uint32_t poolsFree = 0;
+        uint32_t poolOverflows = 0;         // number of times allocation spilled into another pool
+        uint32_t resets = 0;
+        uint64_t setsAllocated = 0;         // since last reset
+        uint64_t totalSetsAllocated = 0;    // over lifetime of allocator
+    };
+
+    void init(VkDevice device, uint32_t initialSetsPerPool = 64);
+    void cleanup();
+
+    // applies to pools created afterwards, recycled pools keep their sizes
+    void setPoolSizes(const PoolSizes& poolSizes) { this->poolSizes = poolSizes; }
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    void resetPools();
+
+    const Stats& getStats() const { return stats; }
+    void printStats(const char* name) const;
+
+private:
+    VkDescriptorPool grabPool();
+    VkDescriptorPool createPool(uint32_t setCount);
+
+    static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+    VkDevice device = VK_NULL_HANDLE;
+    PoolSizes poolSizes;
+    uint32_t setsPerPool = 0;
+    VkDescriptorPool currentPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorPool> usedPools;
+    std::vector<VkDescriptorPool> freePools;
+    Stats stats;
+};
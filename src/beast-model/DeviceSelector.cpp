@@ -0,0 +1,162 @@
+#include "DeviceSelector.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static int getTypeScore(VkPhysicalDeviceType type) {
+    switch (type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return 100;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return 50;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return 30;
+        default:
+            return 10;
+    }
+}
+
+static const char* getTypeString(VkPhysicalDeviceType type) {
+    switch (type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return "discrete";
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return "integrated";
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return "virtual";
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            return "cpu";
+        default:
+            return "other";
+    }
+}
+
+// lowercase hex digits only, so UUID matches with, or without dashes
+static std::string normalizeHex(const std::string& str) {
+    std::string hex;
+    for (char c : str) {
+        if (c != '-')
+            hex.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    }
+    return hex;
+}
+
+static std::string toLower(const std::string& str) {
+    std::string lower = str;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lower;
+}
+
+// features which are optional, but used if present: anisotropic filtering, sample shading, pipeline statistics,
+// memory budget, async compute queue, and GPU timestamps
+static uint32_t countOptionalFeatures(VkPhysicalDevice device, const VkPhysicalDeviceProperties& properties) {
+    VkPhysicalDeviceFeatures features = {};
+    vkGetPhysicalDeviceFeatures(device, &features);
+    uint32_t count = (features.samplerAnisotropy ? 1 : 0) + (features.sampleRateShading ? 1 : 0) + (features.pipelineStatisticsQuery ? 1 : 0);
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+    for (const VkExtensionProperties& extension : extensions) {
+        if (std::strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+            ++count;
+    }
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+    bool hasComputeQueue = false;
+    bool hasTimestamps = false;
+    for (const VkQueueFamilyProperties& family : queueFamilies) {
+        if ((family.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(family.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+            hasComputeQueue = true;
+        if ((family.queueFlags & VK_QUEUE_GRAPHICS_BIT) && family.timestampValidBits > 0 && properties.limits.timestampPeriod > 0.0f)
+            hasTimestamps = true;
+    }
+    return count + (hasComputeQueue ? 1 : 0) + (hasTimestamps ? 1 : 0);
+}
+
+void DeviceSelector::enumerate(VkInstance instance, const std::function<bool(VkPhysicalDevice)>& isSuitable) {
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+    candidates.clear();
+    for (uint32_t i=0; i<deviceCount; ++i) {
+        Candidate candidate;
+        candidate.device = devices[i];
+        candidate.index = i;
+
+        VkPhysicalDeviceIDProperties idProperties = {};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2 = {};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2(devices[i], &properties2);
+        candidate.properties = properties2.properties;
+
+        char uuid[40];
+        const uint8_t* id = idProperties.deviceUUID;
+        std::snprintf(uuid, sizeof(uuid), "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+                id[0], id[1], id[2], id[3], id[4], id[5], id[6], id[7], id[8], id[9], id[10], id[11], id[12], id[13], id[14], id[15]);
+        candidate.uuid = uuid;
+
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(devices[i], &memoryProperties);
+        for (uint32_t h=0; h<memoryProperties.memoryHeapCount; ++h) {
+            if (memoryProperties.memoryHeaps[h].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+                candidate.deviceLocalBytes += memoryProperties.memoryHeaps[h].size;
+        }
+
+        candidate.numFeatures = countOptionalFeatures(devices[i], candidate.properties);
+        candidate.score = isSuitable(devices[i]) ? getTypeScore(candidate.properties.deviceType) : 0;
+        candidates.push_back(candidate);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), isRankedHigher);
+}
+
+const DeviceSelector::Candidate* DeviceSelector::select(const std::string& deviceOverride) const {
+    for (const Candidate& candidate : candidates) {
+        if (candidate.score > 0 && (deviceOverride.empty() || matches(candidate, deviceOverride)))
+            return &candidate;
+    }
+    return nullptr;
+}
+
+void DeviceSelector::print(const Candidate* selected) const {
+    std::printf("Devices (best ranked first, * selected):\n");
+    for (const Candidate& candidate : candidates) {
+        std::printf("  %c [%u] %s (%s, %.0f MB, %u optional features, score %d%s)\n      UUID %s\n",
+                &candidate == selected ? '*' : ' ', candidate.index, candidate.properties.deviceName,
+                getTypeString(candidate.properties.deviceType), candidate.deviceLocalBytes / (1024.0 * 1024.0),
+                candidate.numFeatures, candidate.score, candidate.score > 0 ? "" : ", not suitable", candidate.uuid.c_str());
+    }
+}
+
+bool DeviceSelector::isRankedHigher(const Candidate& a, const Candidate& b) {
+    if (a.score != b.score)
+        return a.score > b.score;
+    if (a.deviceLocalBytes != b.deviceLocalBytes)
+        return a.deviceLocalBytes > b.deviceLocalBytes;
+    if (a.numFeatures != b.numFeatures)
+        return a.numFeatures > b.numFeatures;
+    return a.index < b.index;
+}
+
+bool DeviceSelector::matches(const Candidate& candidate, const std::string& deviceOverride) {
+    if (std::all_of(deviceOverride.begin(), deviceOverride.end(), [](unsigned char c) { return std::isdigit(c); }))
+        return std::strtoul(deviceOverride.c_str(), nullptr, 10) == candidate.index;
+
+    const std::string hex = normalizeHex(deviceOverride);
+    if (hex.size() == 32 && hex == normalizeHex(candidate.uuid))
+        return true;
+
+    return toLower(candidate.properties.deviceName).find(toLower(deviceOverride)) != std::string::npos;
+}
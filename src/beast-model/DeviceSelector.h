@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * Ranks physical devices, and picks one, optionally overridden by the user.
+ * Ranking is by score of device type (discrete, integrated, virtual, then the rest), then size of
+ * device local memory, then number of optional features the renderer makes use of, and finally
+ * enumeration order so the choice is stable. Devices failing suitability check (queues, extensions,
+ * surface support) are never picked, not even by an override.
+ *
+ * Override selects by enumeration index ("1"), UUID as printed by print(), or case-insensitive
+ * substring of device name ("radeon"), the best ranked device wins if a name matches several.
+ */
+class DeviceSelector {
+public:
+    struct Candidate {
+        VkPhysicalDevice device = VK_NULL_HANDLE;
+        uint32_t index = 0;                 // in enumeration order
+        VkPhysicalDeviceProperties properties = {};
+        std::string uuid;                   // formatted as 8-4-4-4-12 hex digits
+        VkDeviceSize deviceLocalBytes = 0;  // summed over device local heaps
+        uint32_t numFeatures = 0;           // optional features supported
+        int score = 0;                      // by device type, 0 if not suitable
+    };
+
+    void enumerate(VkInstance instance, const std::function<bool(VkPhysicalDevice)>& isSuitable);
+    // best ranked suitable device if override is empty, nullptr if there's none, or none matches
+    const Candidate* select(const std::string& deviceOverride) const;
+    void print(const Candidate* selected) const;
+
+    // ranked, best first
+    const std::vector<Candidate>& getCandidates() const { return candidates; }
+
+private:
+    static bool isRankedHigher(const Candidate& a, const Candidate& b);
+    static bool matches(const Candidate& candidate, const std::string& deviceOverride);
+
+    std::vector<Candidate> candidates;
+};
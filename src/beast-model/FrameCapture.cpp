@@ -0,0 +1,145 @@
+#include "FrameCapture.h"
+
+#include <cstring>
+
+const uint32_t CAPTURE_MAGIC = 0x43464d42;     // "BMFC"
+const uint32_t CAPTURE_VERSION = 1;
+
+const uint8_t RECORD_SETTINGS = 1;
+const uint8_t RECORD_FRAME = 2;
+
+const uint32_t FLAG_DEPTH_PREPASS = 1 << 0;
+const uint32_t FLAG_DEFORMATION = 1 << 1;
+const uint32_t FLAG_ASYNC_COMPUTE = 1 << 2;
+
+bool FrameCapture::openWrite(const std::string& path, const Header& header) {
+    close();
+    numFrames = 0;
+    numBytes = 0;
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    writeUint32(CAPTURE_MAGIC);
+    writeUint32(CAPTURE_VERSION);
+    writeUint32(static_cast<uint32_t>(header.scenePath.size()));
+    write(header.scenePath.data(), header.scenePath.size());
+    writeUint32(header.swapChainImageCount);
+    writeUint32((header.depthPrepass ? FLAG_DEPTH_PREPASS : 0) | (header.deformation ? FLAG_DEFORMATION : 0) | (header.asyncCompute ? FLAG_ASYNC_COMPUTE : 0));
+    write(&header.drawHash, sizeof(header.drawHash));
+    writeSettings(header.settings);
+    lastSettings = header.settings;
+    return true;
+}
+
+void FrameCapture::writeFrame(const Settings& settings, const Frame& frame) {
+    if (file == nullptr)
+        return;
+
+    if (settings != lastSettings) {
+        write(&RECORD_SETTINGS, 1);
+        writeSettings(settings);
+        lastSettings = settings;
+    }
+    write(&RECORD_FRAME, 1);
+    write(&frame.time, sizeof(frame.time));
+    write(&frame.model[0][0], sizeof(float) * 16);
+    ++numFrames;
+}
+
+bool FrameCapture::openRead(const std::string& path, Header& header) {
+    close();
+    FILE* input = std::fopen(path.c_str(), "rb");
+    if (input == nullptr)
+        return false;
+    std::fseek(input, 0, SEEK_END);
+    const long size = std::ftell(input);
+    std::fseek(input, 0, SEEK_SET);
+    data.resize(size > 0 ? static_cast<size_t>(size) : 0);
+    const bool isRead = std::fread(data.data(), 1, data.size(), input) == data.size();
+    std::fclose(input);
+    numFrames = 0;
+    numBytes = data.size();
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t pathLength = 0;
+    if (!isRead || !readUint32(magic) || !readUint32(version) || magic != CAPTURE_MAGIC || version != CAPTURE_VERSION ||
+        !readUint32(pathLength) || pathLength > data.size() - readOffset) {
+        data.clear();
+        return false;
+    }
+    header.scenePath.assign(data.data() + readOffset, pathLength);
+    readOffset += pathLength;
+
+    uint32_t flags = 0;
+    if (!readUint32(header.swapChainImageCount) || !readUint32(flags) || !read(&header.drawHash, sizeof(header.drawHash)) || !readSettings(header.settings)) {
+        data.clear();
+        return false;
+    }
+    header.depthPrepass = (flags & FLAG_DEPTH_PREPASS) != 0;
+    header.deformation = (flags & FLAG_DEFORMATION) != 0;
+    header.asyncCompute = (flags & FLAG_ASYNC_COMPUTE) != 0;
+    return true;
+}
+
+bool FrameCapture::readFrame(Settings& settings, Frame& frame) {
+    uint8_t type;
+    while (read(&type, 1)) {
+        if (type == RECORD_SETTINGS) {
+            if (!readSettings(settings))
+                return false;
+        }
+        else if (type == RECORD_FRAME) {
+            if (!read(&frame.time, sizeof(frame.time)) || !read(&frame.model[0][0], sizeof(float) * 16))
+                return false;
+            ++numFrames;
+            return true;
+        }
+        else {
+            // unknown record, the rest can't be parsed
+            return false;
+        }
+    }
+    return false;
+}
+
+void FrameCapture::close() {
+    if (file != nullptr)
+        std::fclose(file);
+    file = nullptr;
+    data.clear();
+    readOffset = 0;
+}
+
+void FrameCapture::write(const void* bytes, size_t size) {
+    std::fwrite(bytes, 1, size, file);
+    numBytes += size;
+}
+
+void FrameCapture::writeSettings(const Settings& settings) {
+    writeUint32(settings.width);
+    writeUint32(settings.height);
+    writeUint32(settings.msaaSamples);
+    writeUint32(settings.sampleShading ? 1 : 0);
+}
+
+bool FrameCapture::read(void* bytes, size_t size) {
+    if (size > data.size() - readOffset)
+        return false;
+    std::memcpy(bytes, data.data() + readOffset, size);
+    readOffset += size;
+    return true;
+}
+
+bool FrameCapture::readSettings(Settings& settings) {
+    uint32_t sampleShading = 0;
+    if (!readUint32(settings.width) || !readUint32(settings.height) || !readUint32(settings.msaaSamples) || !readUint32(sampleShading))
+        return false;
+    // corrupt, or foreign capture would otherwise reach image creation
+    const bool isSampleCountValid = settings.msaaSamples >= 1 && settings.msaaSamples <= 64 && (settings.msaaSamples & (settings.msaaSamples - 1)) == 0;
+    if (!isSampleCountValid || settings.width == 0 || settings.height == 0)
+        return false;
+    settings.sampleShading = sampleShading != 0;
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * Capture of everything that drives rendering, written to a compact binary file so a session can
+ * be replayed deterministically without window, input, or the application's own animation code.
+ *
+ * Command buffers are pre-recorded from the scene, so what's captured is
+ * - header: what resources are created from (scene, swapchain's image count, passes enabled), and
+ *   a hash of draw parameters so replay can tell it loaded the same draws
+ * - settings record: swapchain's extent, and quality settings which command buffers are recorded
+ *   with, written at start, and only again when they change
+ * - frame record: inputs a frame consumes, animation time, and model matrix (rest of uniform data is
+ *   derived from extent, and fixed camera)
+ *
+ * File is in host byte order, it's meant to be replayed on the machine class it was captured on.
+ */
+class FrameCapture {
+public:
+    struct Settings {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t msaaSamples = 1;
+        bool sampleShading = false;
+
+        bool operator==(const Settings& other) const {
+            return width == other.width && height == other.height && msaaSamples == other.msaaSamples && sampleShading == other.sampleShading;
+        }
+        bool operator!=(const Settings& other) const { return !(*this == other); }
+    };
+
+    struct Header {
+        std::string scenePath;          // empty for the built-in model
+        uint32_t swapChainImageCount = 0;
+        bool depthPrepass = false;
+        bool deformation = false;
+        bool asyncCompute = false;
+        uint64_t drawHash = 0;          // of draw parameters
+        Settings settings;              // in effect at the first frame
+    };
+
+    struct Frame {
+        float time = 0.0f;              // animation time in seconds
+        glm::mat4 model = glm::mat4(1.0f);
+    };
+
+    ~FrameCapture() { close(); }
+
+    bool openWrite(const std::string& path, const Header& header);
+    // settings are written ahead of the frame only if they changed
+    void writeFrame(const Settings& settings, const Frame& frame);
+    bool isRecording() const { return file != nullptr; }
+
+    // whole capture is loaded into memory, so reading a frame does no I/O
+    bool openRead(const std::string& path, Header& header);
+    // false at the end of capture, settings are updated if they changed before this frame,
+    // settings with zero extent, or sample count not a power of two up to 64 are rejected as corrupt
+    bool readFrame(Settings& settings, Frame& frame);
+
+    void close();
+    uint32_t getNumFrames() const { return numFrames; }
+    uint64_t getNumBytes() const { return numBytes; }
+
+private:
+    void write(const void* bytes, size_t size);
+    void writeUint32(uint32_t value) { write(&value, sizeof(value)); }
+    void writeSettings(const Settings& settings);
+    bool read(void* bytes, size_t size);
+    bool readUint32(uint32_t& value) { return read(&value, sizeof(value)); }
+    bool readSettings(Settings& settings);
+
+    FILE* file = nullptr;
+    Settings lastSettings;
+    std::vector<char> data;
+    size_t readOffset = 0;
+    uint32_t numFrames = 0;
+    uint64_t numBytes = 0;
+};
@@ -0,0 +1,96 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+void FramePacer::setTargetFrameRate(double fps) {
+    targetIntervalSec = fps > 0.0 ? 1.0 / fps : 0.0;
+}
+
+double FramePacer::getTargetIntervalSec() const {
+    return targetIntervalSec > 0.0 ? targetIntervalSec : measuredIntervalSec;
+}
+
+void FramePacer::waitForInputSample() {
+    const double intervalSec = getTargetIntervalSec();
+    if (!enabled || !hasLastPresent || intervalSec <= 0.0)
+        return;
+
+    // the next present is expected one interval after the last one, start the frame
+    // just in time for its (estimated) work to finish by then
+    const double startOffsetSec = intervalSec - workEstimateSec - SAFETY_MARGIN_SEC;
+    if (startOffsetSec <= 0.0)
+        return;
+
+    const Clock::time_point wakeTime = lastPresent + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(startOffsetSec));
+    const Clock::time_point sleepUntil = wakeTime - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(SPIN_THRESHOLD_SEC));
+
+    if (Clock::now() < sleepUntil)
+        std::this_thread::sleep_until(sleepUntil);
+    while (Clock::now() < wakeTime)
+        std::this_thread::yield();
+}
+
+void FramePacer::beginWork() {
+    workStart = Clock::now();
+    hasWorkStart = true;
+}
+
+void FramePacer::endWork() {
+    if (!hasWorkStart)
+        return;
+    hasWorkStart = false;
+
+    // a sample is capped at one interval, a single hitch shouldn't turn pacing off for long;
+    // track increases quickly to avoid missing an interval, decay slowly otherwise
+    double workSec = std::chrono::duration<double>(Clock::now() - workStart).count();
+    const double intervalSec = getTargetIntervalSec();
+    if (intervalSec > 0.0)
+        workSec = std::min(workSec, intervalSec);
+    workEstimateSec += (workSec > workEstimateSec ? RISE_SMOOTHING : SMOOTHING) * (workSec - workEstimateSec);
+}
+
+void FramePacer::onPresent() {
+    const Clock::time_point now = Clock::now();
+
+    if (hasLastPresent) {
+        const double intervalSec = std::chrono::duration<double>(now - lastPresent).count();
+        measuredIntervalSec = measuredIntervalSec == 0.0 ? intervalSec : measuredIntervalSec + SMOOTHING * (intervalSec - measuredIntervalSec);
+
+        intervalHistory[historyHead] = intervalSec;
+        historyHead = (historyHead + 1) % HISTORY_SIZE;
+        historyCount = std::min(historyCount + 1, HISTORY_SIZE);
+    }
+
+    lastPresent = now;
+    hasLastPresent = true;
+}
+
+FramePacer::PresentStats FramePacer::getPresentStats() const {
+    PresentStats stats;
+    if (historyCount == 0)
+        return stats;
+
+    double sum = 0.0;
+    double minSec = intervalHistory[0];
+    double maxSec = intervalHistory[0];
+    for (size_t i=0; i<historyCount; ++i) {
+        sum += intervalHistory[i];
+        minSec = std::min(minSec, intervalHistory[i]);
+        maxSec = std::max(maxSec, intervalHistory[i]);
+    }
+    const double avgSec = sum / historyCount;
+
+    double variance = 0.0;
+    for (size_t i=0; i<historyCount; ++i)
+        variance += (intervalHistory[i] - avgSec) * (intervalHistory[i] - avgSec);
+    variance /= historyCount;
+
+    stats.samples = static_cast<uint32_t>(historyCount);
+    stats.avgMs = avgSec * 1000.0;
+    stats.minMs = minSec * 1000.0;
+    stats.maxMs = maxSec * 1000.0;
+    stats.jitterMs = std::sqrt(variance) * 1000.0;
+    return stats;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Latency oriented frame pacing.
+ * Instead of sampling input right after the previous present and then waiting
+ * inside acquire/present, sleep first so that input is sampled as late as
+ * possible while still leaving enough time to record, submit and present the
+ * frame before the next presentation interval.
+ *
+ * Also keeps history of measured present intervals (CPU side, between returns
+ * of vkQueuePresentKHR).
+ */
+class FramePacer {
+public:
+    struct PresentStats {
+        uint32_t samples = 0;
+        double avgMs = 0.0;
+        double minMs = 0.0;
+        double maxMs = 0.0;
+        double jitterMs = 0.0;      // standard deviation
+    };
+
+    // 0 means follow measured present interval (i.e. display refresh rate with FIFO)
+    void setTargetFrameRate(double fps);
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+    bool isEnabled() const { return enabled; }
+
+    // call just before sampling input (glfwPollEvents)
+    void waitForInputSample();
+    // call once the frame's image is available (acquired, and waited on), marks start of frame's CPU work;
+    // blocking in acquire/present isn't work, under FIFO it'd take up the whole interval
+    void beginWork();
+    // call right after vkQueueSubmit returned
+    void endWork();
+    // call right after vkQueuePresentKHR returned
+    void onPresent();
+
+    PresentStats getPresentStats() const;
+    double getEstimatedWorkMs() const { return workEstimateSec * 1000.0; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    double getTargetIntervalSec() const;
+
+    static constexpr size_t HISTORY_SIZE = 120;
+    static constexpr double SMOOTHING = 0.1;               // weight of newest sample in moving averages
+    static constexpr double RISE_SMOOTHING = 0.5;          // weight of a work sample above estimate, adapt quickly but not to a single hitch
+    static constexpr double SAFETY_MARGIN_SEC = 0.001;     // slack left for scheduling noise
+    static constexpr double SPIN_THRESHOLD_SEC = 0.002;    // busy-wait for the last part, sleep is too coarse
+
+    bool enabled = false;
+    double targetIntervalSec = 0.0;
+    double measuredIntervalSec = 0.0;
+    double workEstimateSec = 0.0;
+
+    Clock::time_point workStart;
+    Clock::time_point lastPresent;
+    bool hasWorkStart = false;
+    bool hasLastPresent = false;
+
+    std::array<double, HISTORY_SIZE> intervalHistory = {};
+    size_t historyHead = 0;
+    size_t historyCount = 0;
+};
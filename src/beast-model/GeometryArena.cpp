@@ -0,0 +1,239 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+// alignment isn't necessarily a power of two (e.g. vertex stride)
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+void GeometryArena::init(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize capacity, VkMemoryPropertyFlags properties, MemoryTracker* memoryTracker) {
+    this->device = device;
+    this->physicalDevice = physicalDevice;
+    this->memoryTracker = memoryTracker;
+    this->capacity = capacity;
+    memoryProperties = properties;
+
+    createBuffer(buffer, memory);
+
+    allocations.clear();
+    freeHandles.clear();
+    freeRanges.clear();
+    freeRanges.push_back({ 0, capacity });
+}
+
+void GeometryArena::cleanup() {
+    vkDestroyBuffer(device, buffer, nullptr);
+    freeMemory(memory);
+    buffer = VK_NULL_HANDLE;
+    memory = VK_NULL_HANDLE;
+}
+
+void GeometryArena::createBuffer(VkBuffer& outBuffer, VkDeviceMemory& outMemory) {
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = capacity;
+    // transfer source for defragmentation
+    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &outBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to create geometry arena buffer!");
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, outBuffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, memoryProperties);
+
+    const VkResult result = memoryTracker != nullptr ? memoryTracker->allocate(device, allocInfo, MemoryTag::Geometry, outMemory) : vkAllocateMemory(device, &allocInfo, nullptr, &outMemory);
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate geometry arena memory!");
+
+    vkBindBufferMemory(device, outBuffer, outMemory, 0);
+}
+
+uint32_t GeometryArena::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (uint32_t i=0; i<memProperties.memoryTypeCount; ++i) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            return i;
+    }
+
+    throw std::runtime_error("failed to find suitable memory type for geometry arena!");
+}
+
+GeometryArena::AllocationHandle GeometryArena::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    // first-fit, padding in front of aligned offset is kept as a free range
+    for (size_t i=0; i<freeRanges.size(); ++i) {
+        const FreeRange range = freeRanges[i];
+        const VkDeviceSize offset = alignUp(range.offset, alignment);
+        if (offset + size > range.offset + range.size)
+            continue;
+
+        freeRanges.erase(freeRanges.begin() + i);
+        if (offset > range.offset)
+            addFreeRange(range.offset, offset - range.offset);
+        if (offset + size < range.offset + range.size)
+            addFreeRange(offset + size, range.offset + range.size - (offset + size));
+
+        Allocation allocation = { offset, size, alignment, true };
+        if (!freeHandles.empty()) {
+            const AllocationHandle handle = freeHandles.back();
+            freeHandles.pop_back();
+            allocations[handle] = allocation;
+            return handle;
+        }
+        allocations.push_back(allocation);
+        return static_cast<AllocationHandle>(allocations.size() - 1);
+    }
+
+    throw std::runtime_error("geometry arena is out of space!");
+}
+
+void GeometryArena::free(AllocationHandle handle) {
+    Allocation& allocation = allocations[handle];
+    if (!allocation.isLive)
+        return;
+
+    addFreeRange(allocation.offset, allocation.size);
+    allocation.isLive = false;
+    freeHandles.push_back(handle);
+}
+
+// insert keeping list sorted, and merge with neighbours
+void GeometryArena::addFreeRange(VkDeviceSize offset, VkDeviceSize size) {
+    auto it = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset, [](const FreeRange& range, VkDeviceSize value) {
+        return range.offset < value;
+    });
+    it = freeRanges.insert(it, { offset, size });
+
+    auto next = it + 1;
+    if (next != freeRanges.end() && it->offset + it->size == next->offset) {
+        it->size += next->size;
+        freeRanges.erase(next);
+    }
+    if (it != freeRanges.begin()) {
+        auto prev = it - 1;
+        if (prev->offset + prev->size == it->offset) {
+            prev->size += it->size;
+            freeRanges.erase(it);
+        }
+    }
+}
+
+GeometryArena::RetiredBuffer GeometryArena::defragment(VkCommandBuffer commandBuffer) {
+    // copying within the same buffer would need non-overlapping regions, so pack into a fresh one instead
+    VkBuffer newBuffer;
+    VkDeviceMemory newMemory;
+    createBuffer(newBuffer, newMemory);
+
+    RetiredBuffer retired;
+    retired.buffer = buffer;
+    retired.memory = memory;
+    buffer = newBuffer;
+    memory = newMemory;
+
+    std::vector<AllocationHandle> live;
+    for (size_t i=0; i<allocations.size(); ++i) {
+        if (allocations[i].isLive)
+            live.push_back(static_cast<AllocationHandle>(i));
+    }
+    std::sort(live.begin(), live.end(), [&](AllocationHandle a, AllocationHandle b) {
+        return allocations[a].offset < allocations[b].offset;
+    });
+
+    std::vector<VkBufferCopy> regions;
+    VkDeviceSize offset = 0;
+    for (AllocationHandle handle : live) {
+        Allocation& allocation = allocations[handle];
+        offset = alignUp(offset, allocation.alignment);
+
+        VkBufferCopy region = {};
+        region.srcOffset = allocation.offset;
+        region.dstOffset = offset;
+        region.size = allocation.size;
+        regions.push_back(region);
+
+        allocation.offset = offset;
+        offset += allocation.size;
+        bytesMoved += allocation.size;
+    }
+
+    if (!regions.empty())
+        vkCmdCopyBuffer(commandBuffer, retired.buffer, buffer, static_cast<uint32_t>(regions.size()), regions.data());
+
+    // padding between packed allocations is free as well
+    freeRanges.clear();
+    VkDeviceSize end = 0;
+    for (AllocationHandle handle : live) {
+        if (allocations[handle].offset > end)
+            addFreeRange(end, allocations[handle].offset - end);
+        end = allocations[handle].offset + allocations[handle].size;
+    }
+    if (end < capacity)
+        addFreeRange(end, capacity - end);
+
+    ++defragmentations;
+    return retired;
+}
+
+void GeometryArena::destroyRetired(const RetiredBuffer& retired) {
+    vkDestroyBuffer(device, retired.buffer, nullptr);
+    freeMemory(retired.memory);
+}
+
+void GeometryArena::freeMemory(VkDeviceMemory memory) {
+    if (memoryTracker != nullptr)
+        memoryTracker->free(device, memory);
+    else
+        vkFreeMemory(device, memory, nullptr);
+}
+
+float GeometryArena::getFragmentation() const {
+    VkDeviceSize totalFree = 0;
+    VkDeviceSize largestFree = 0;
+    for (const FreeRange& range : freeRanges) {
+        totalFree += range.size;
+        largestFree = std::max(largestFree, range.size);
+    }
+    return totalFree > 0 ? 1.0f - static_cast<float>(largestFree) / static_cast<float>(totalFree) : 0.0f;
+}
+
+GeometryArena::Stats GeometryArena::getStats() const {
+    Stats stats;
+    stats.capacity = capacity;
+    stats.numFreeRanges = static_cast<uint32_t>(freeRanges.size());
+    stats.defragmentations = defragmentations;
+    stats.bytesMoved = bytesMoved;
+
+    VkDeviceSize totalFree = 0;
+    for (const FreeRange& range : freeRanges) {
+        totalFree += range.size;
+        stats.largestFreeRange = std::max(stats.largestFreeRange, range.size);
+    }
+    stats.usedBytes = capacity - totalFree;
+
+    for (const Allocation& allocation : allocations) {
+        if (allocation.isLive)
+            ++stats.numAllocations;
+    }
+    return stats;
+}
+
+void GeometryArena::printStats(const char* name) const {
+    const Stats stats = getStats();
+    std::printf("Geometry arena [%s]: %u allocation(s), %llu/%llu KB used, %u free range(s) (largest %llu KB, fragmentation %.2f)",
+            name, stats.numAllocations,
+            static_cast<unsigned long long>(stats.usedBytes / 1024), static_cast<unsigned long long>(stats.capacity / 1024),
+            stats.numFreeRanges, static_cast<unsigned long long>(stats.largestFreeRange / 1024), getFragmentation());
+    if (stats.defragmentations > 0)
+        std::printf(", %u defragmentation(s) moved %llu KB", stats.defragmentations, static_cast<unsigned long long>(stats.bytesMoved / 1024));
+    std::printf("\n");
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "MemoryTracker.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Single buffer holding vertices, and indices of every mesh (VERTEX | INDEX usage).
+ * Ranges are suballocated first-fit from a sorted free list which coalesces on free.
+ * Buffer is bound once, draws then address each mesh via vertexOffset/firstIndex.
+ *
+ * defragment() packs all live allocations to the front of a fresh buffer (copies are
+ * recorded into the given command buffer), handles stay valid but their offsets change,
+ * so anything recorded with old offsets has to be re-recorded.
+ */
+class GeometryArena {
+public:
+    typedef uint32_t AllocationHandle;
+
+    struct Stats {
+        VkDeviceSize capacity = 0;
+        VkDeviceSize usedBytes = 0;         // including alignment padding
+        uint32_t numAllocations = 0;
+        uint32_t numFreeRanges = 0;
+        VkDeviceSize largestFreeRange = 0;
+        uint32_t defragmentations = 0;
+        VkDeviceSize bytesMoved = 0;        // by all defragmentations
+    };
+
+    // buffer replaced by defragment(), destroy it once copies recorded from it have completed
+    struct RetiredBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    };
+
+    // allocations are accounted as MemoryTag::Geometry if memoryTracker is given
+    void init(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize capacity, VkMemoryPropertyFlags properties, MemoryTracker* memoryTracker = nullptr);
+    void cleanup();
+
+    // throws std::runtime_error if there's no free range large enough
+    AllocationHandle allocate(VkDeviceSize size, VkDeviceSize alignment);
+    void free(AllocationHandle handle);
+
+    VkDeviceSize getOffset(AllocationHandle handle) const { return allocations[handle].offset; }
+    VkDeviceSize getSize(AllocationHandle handle) const { return allocations[handle].size; }
+    VkDeviceSize getCapacity() const { return capacity; }
+    VkBuffer getBuffer() const { return buffer; }
+    VkDeviceMemory getMemory() const { return memory; }
+
+    RetiredBuffer defragment(VkCommandBuffer commandBuffer);
+    void destroyRetired(const RetiredBuffer& retired);
+
+    // 0 when all free space is contiguous, approaches 1 as it gets split into small ranges
+    float getFragmentation() const;
+    Stats getStats() const;
+    void printStats(const char* name) const;
+
+private:
+    struct Allocation {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        VkDeviceSize alignment;
+        bool isLive;
+    };
+
+    struct FreeRange {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    void createBuffer(VkBuffer& outBuffer, VkDeviceMemory& outMemory);
+    void freeMemory(VkDeviceMemory memory);
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    void addFreeRange(VkDeviceSize offset, VkDeviceSize size);
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    MemoryTracker* memoryTracker = nullptr;
+    VkMemoryPropertyFlags memoryProperties = 0;
+    VkDeviceSize capacity = 0;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+
+    std::vector<Allocation> allocations;
+    std::vector<AllocationHandle> freeHandles;      // recycled allocation slots
+    std::vector<FreeRange> freeRanges;              // sorted by offset, never adjacent
+    uint32_t defragmentations = 0;
+    VkDeviceSize bytesMoved = 0;
+};
@@ -0,0 +1,126 @@
+#include "GoldenImage.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+const uint32_t MAX_STORED_BLOCK_SIZE = 65535;
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256] = {};
+    if (table[1] == 0) {
+        for (uint32_t i=0; i<256; ++i) {
+            uint32_t c = i;
+            for (int k=0; k<8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+    }
+
+    crc = ~crc;
+    for (size_t i=0; i<size; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t adler32(const std::vector<uint8_t>& data) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (size_t i=0; i<data.size(); ++i) {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// length, type, data, and CRC over type, and data
+static void appendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    appendBigEndian(out, static_cast<uint32_t>(data.size()));
+    const size_t typeOffset = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    appendBigEndian(out, crc32(out.data() + typeOffset, out.size() - typeOffset));
+}
+
+bool GoldenImage::load(const std::string& path) {
+    int w, h, channels;
+    stbi_uc* data = stbi_load(path.c_str(), &w, &h, &channels, STBI_rgb_alpha);
+    if (!data)
+        return false;
+
+    width = static_cast<uint32_t>(w);
+    height = static_cast<uint32_t>(h);
+    pixels.assign(data, data + static_cast<size_t>(w) * h * 4);
+    stbi_image_free(data);
+    return true;
+}
+
+bool GoldenImage::save(const std::string& path) const {
+    // every scanline starts with filter type 0 (none)
+    const size_t rowSize = static_cast<size_t>(width) * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowSize + 1) * height);
+    for (uint32_t y=0; y<height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + y * rowSize, pixels.begin() + (y + 1) * rowSize);
+    }
+
+    // zlib stream of stored blocks: header, blocks of (final flag, LEN, NLEN, data), adler32
+    std::vector<uint8_t> zlib = { 0x78, 0x01 };
+    size_t offset = 0;
+    do {
+        const uint32_t blockSize = static_cast<uint32_t>(std::min<size_t>(raw.size() - offset, MAX_STORED_BLOCK_SIZE));
+        const bool isFinal = offset + blockSize == raw.size();
+        zlib.push_back(isFinal ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(blockSize));
+        zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+        zlib.push_back(static_cast<uint8_t>(~blockSize));
+        zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < raw.size());
+    appendBigEndian(zlib, adler32(raw));
+
+    // 8-bit RGBA, default compression, filter, and no interlace
+    std::vector<uint8_t> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });
+
+    std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    file.write(reinterpret_cast<const char*>(png.data()), png.size());
+    return file.good();
+}
+
+double GoldenImage::computePsnr(const GoldenImage& a, const GoldenImage& b) {
+    double sumSquaredError = 0.0;
+    const size_t numPixels = static_cast<size_t>(a.width) * a.height;
+    for (size_t i=0; i<numPixels; ++i) {
+        for (size_t c=0; c<3; ++c) {
+            const double diff = static_cast<double>(a.pixels[i*4 + c]) - b.pixels[i*4 + c];
+            sumSquaredError += diff * diff;
+        }
+    }
+
+    if (numPixels == 0 || sumSquaredError == 0.0)
+        return std::numeric_limits<double>::infinity();
+    const double mse = sumSquaredError / (numPixels * 3);
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * RGBA8 image for golden-image regression checks, with rows from top to bottom.
+ * PNG is loaded through stb_image, and saved with stored (uncompressed) deflate blocks which
+ * every PNG reader accepts, so there's no need for an encoder just to write test artifacts.
+ *
+ * Comparison is done by PSNR over RGB channels, alpha of a swapchain image isn't meaningful.
+ */
+class GoldenImage {
+public:
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    // peak signal-to-noise ratio in dB, infinity if identical, images have to be of the same size
+    static double computePsnr(const GoldenImage& a, const GoldenImage& b);
+};
@@ -0,0 +1,134 @@
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cstdio>
+
+const double BYTES_PER_MB = 1024.0 * 1024.0;
+
+void MemoryTracker::init(VkPhysicalDevice physicalDevice, bool isBudgetExtensionEnabled) {
+    this->physicalDevice = physicalDevice;
+    this->isBudgetExtensionEnabled = isBudgetExtensionEnabled;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+}
+
+VkResult MemoryTracker::allocate(VkDevice device, const VkMemoryAllocateInfo& allocInfo, MemoryTag tag, VkDeviceMemory& memory, bool isStreamed) {
+    const uint32_t heapIndex = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].heapIndex;
+
+    if (isStreamed && !isWithinBudget(heapIndex, allocInfo.allocationSize)) {
+        ++numRefused;
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+
+    VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+    if (result != VK_SUCCESS)
+        return result;
+
+    allocations[memory] = {allocInfo.allocationSize, heapIndex, tag};
+
+    TagStats& stats = tagStats[static_cast<size_t>(tag)];
+    stats.liveBytes += allocInfo.allocationSize;
+    stats.peakBytes = std::max(stats.peakBytes, stats.liveBytes);
+    ++stats.numAllocations;
+
+    heapBytes[heapIndex] += allocInfo.allocationSize;
+    heapPeakBytes[heapIndex] = std::max(heapPeakBytes[heapIndex], heapBytes[heapIndex]);
+    return VK_SUCCESS;
+}
+
+void MemoryTracker::free(VkDevice device, VkDeviceMemory memory) {
+    if (memory == VK_NULL_HANDLE)
+        return;
+
+    auto it = allocations.find(memory);
+    if (it != allocations.end()) {
+        const Allocation& allocation = it->second;
+        TagStats& stats = tagStats[static_cast<size_t>(allocation.tag)];
+        stats.liveBytes -= allocation.size;
+        --stats.numAllocations;
+        heapBytes[allocation.heapIndex] -= allocation.size;
+        allocations.erase(it);
+    }
+    vkFreeMemory(device, memory, nullptr);
+}
+
+MemoryTracker::HeapStats MemoryTracker::getHeapStats(uint32_t heapIndex) const {
+    HeapStats stats;
+    stats.size = memoryProperties.memoryHeaps[heapIndex].size;
+    stats.isDeviceLocal = (memoryProperties.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    stats.trackedBytes = heapBytes[heapIndex];
+    stats.peakTrackedBytes = heapPeakBytes[heapIndex];
+    stats.usage = stats.trackedBytes;
+    stats.budget = stats.size;
+
+    if (isBudgetExtensionEnabled) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 properties2 = {};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties2.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties2);
+
+        stats.usage = budgetProperties.heapUsage[heapIndex];
+        stats.budget = budgetProperties.heapBudget[heapIndex];
+    }
+
+    if (budgetLimit > 0 && stats.isDeviceLocal)
+        stats.budget = std::min(stats.budget, budgetLimit);
+    return stats;
+}
+
+bool MemoryTracker::isWithinBudget(uint32_t heapIndex, VkDeviceSize size) const {
+    const HeapStats stats = getHeapStats(heapIndex);
+    return stats.usage + size <= stats.budget;
+}
+
+VkDeviceSize MemoryTracker::getDeviceLocalUsage() const {
+    VkDeviceSize usage = 0;
+    for (uint32_t i=0; i<memoryProperties.memoryHeapCount; ++i) {
+        const HeapStats stats = getHeapStats(i);
+        if (stats.isDeviceLocal)
+            usage += stats.usage;
+    }
+    return usage;
+}
+
+VkDeviceSize MemoryTracker::getDeviceLocalBudget() const {
+    VkDeviceSize budget = 0;
+    for (uint32_t i=0; i<memoryProperties.memoryHeapCount; ++i) {
+        const HeapStats stats = getHeapStats(i);
+        if (stats.isDeviceLocal)
+            budget += stats.budget;
+    }
+    return budget;
+}
+
+const char* MemoryTracker::getTagName(MemoryTag tag) {
+    switch (tag) {
+        case MemoryTag::Geometry: return "geometry";
+        case MemoryTag::Texture: return "texture";
+        case MemoryTag::Attachment: return "attachment";
+        case MemoryTag::Uniform: return "uniform";
+        case MemoryTag::Staging: return "staging";
+        case MemoryTag::Skinning: return "skinning";
+        case MemoryTag::Transient: return "transient";
+        case MemoryTag::Readback: return "readback";
+        default: return "unknown";
+    }
+}
+
+void MemoryTracker::printStats() const {
+    std::printf("Device memory (%s)\n", isBudgetExtensionEnabled ? "VK_EXT_memory_budget" : "tracked allocations only");
+    for (size_t i=0; i<tagStats.size(); ++i) {
+        const TagStats& stats = tagStats[i];
+        if (stats.peakBytes == 0)
+            continue;
+        std::printf("  %-10s %9.2f MB live in %u allocation(s), %9.2f MB peak\n", getTagName(static_cast<MemoryTag>(i)), stats.liveBytes / BYTES_PER_MB, stats.numAllocations, stats.peakBytes / BYTES_PER_MB);
+    }
+    for (uint32_t i=0; i<memoryProperties.memoryHeapCount; ++i) {
+        const HeapStats stats = getHeapStats(i);
+        std::printf("  heap %u%s %9.2f MB used of %9.2f MB budget (%9.2f MB tracked, %9.2f MB peak, %9.2f MB heap)\n", i, stats.isDeviceLocal ? " (device local)" : "",
+                stats.usage / BYTES_PER_MB, stats.budget / BYTES_PER_MB, stats.trackedBytes / BYTES_PER_MB, stats.peakTrackedBytes / BYTES_PER_MB, stats.size / BYTES_PER_MB);
+    }
+    if (numRefused > 0)
+        std::printf("  %u streamed allocation(s) refused over budget\n", numRefused);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+// what an allocation is used for, vertices, and indices share geometry arena's buffer
+enum class MemoryTag : uint32_t {
+    Geometry,
+    Texture,
+    Attachment,
+    Uniform,
+    Staging,
+    Skinning,
+    Transient,      // render graph's aliased resources
+    Readback,
+    Count
+};
+
+/*
+ * Device memory accounting. Every vkAllocateMemory/vkFreeMemory goes through allocate()/free(),
+ * so live bytes, and high-water marks are known per tag, and per heap.
+ *
+ * Heap usage, and budget come from VK_EXT_memory_budget when it's enabled (they include
+ * allocations made by the driver, and other parts of the process), otherwise from tracked
+ * allocations, and heap size. setBudgetLimit() lowers budget of device local heaps, useful
+ * to exercise over-budget paths.
+ *
+ * Allocations flagged as streamed are optional (e.g. textures which have a fallback), when
+ * they would exceed budget they are refused with VK_ERROR_OUT_OF_DEVICE_MEMORY without calling
+ * into the driver. Nothing is evicted to make room, textures are only loaded once at startup.
+ */
+class MemoryTracker {
+public:
+    struct TagStats {
+        VkDeviceSize liveBytes = 0;
+        VkDeviceSize peakBytes = 0;
+        uint32_t numAllocations = 0;    // live
+    };
+
+    struct HeapStats {
+        VkDeviceSize size = 0;
+        VkDeviceSize usage = 0;
+        VkDeviceSize budget = 0;
+        VkDeviceSize trackedBytes = 0;
+        VkDeviceSize peakTrackedBytes = 0;
+        bool isDeviceLocal = false;
+    };
+
+    void init(VkPhysicalDevice physicalDevice, bool isBudgetExtensionEnabled);
+    void setBudgetLimit(VkDeviceSize bytes) { budgetLimit = bytes; }
+    bool hasBudgetExtension() const { return isBudgetExtensionEnabled; }
+
+    VkResult allocate(VkDevice device, const VkMemoryAllocateInfo& allocInfo, MemoryTag tag, VkDeviceMemory& memory, bool isStreamed = false);
+    // null handle is ignored, same as vkFreeMemory
+    void free(VkDevice device, VkDeviceMemory memory);
+
+    const TagStats& getTagStats(MemoryTag tag) const { return tagStats[static_cast<size_t>(tag)]; }
+    uint32_t getHeapCount() const { return memoryProperties.memoryHeapCount; }
+    HeapStats getHeapStats(uint32_t heapIndex) const;
+    // summed over device local heaps
+    VkDeviceSize getDeviceLocalUsage() const;
+    VkDeviceSize getDeviceLocalBudget() const;
+    uint32_t getNumRefused() const { return numRefused; }
+
+    void printStats() const;
+    static const char* getTagName(MemoryTag tag);
+
+private:
+    struct Allocation {
+        VkDeviceSize size;
+        uint32_t heapIndex;
+        MemoryTag tag;
+    };
+
+    bool isWithinBudget(uint32_t heapIndex, VkDeviceSize size) const;
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties = {};
+    bool isBudgetExtensionEnabled = false;
+    VkDeviceSize budgetLimit = 0;
+
+    std::unordered_map<VkDeviceMemory, Allocation> allocations;
+    std::array<TagStats, static_cast<size_t>(MemoryTag::Count)> tagStats = {};
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapBytes = {};
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapPeakBytes = {};
+    uint32_t numRefused = 0;
+};
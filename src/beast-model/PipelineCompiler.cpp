@@ -0,0 +1,134 @@
+#include "PipelineCompiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// header version one, as laid out at the start of cache data
+const size_t CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+void PipelineCompiler::init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t numThreads, const std::string& cachePath) {
+    this->device = device;
+    this->cachePath = cachePath;
+
+    std::vector<char> initialData = loadCacheData(physicalDevice);
+    isLoaded = !initialData.empty();
+
+    VkPipelineCacheCreateInfo cacheInfo = {};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = initialData.size();
+    cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+        throw std::runtime_error("failed to create pipeline cache!");
+
+    isStopping = false;
+    for (uint32_t i=0; i<numThreads; ++i)
+        workers.emplace_back(&PipelineCompiler::workerLoop, this);
+}
+
+void PipelineCompiler::cleanup() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    jobAvailable.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+
+    if (pipelineCache != VK_NULL_HANDLE) {
+        if (!cachePath.empty())
+            saveCacheData();
+        vkDestroyPipelineCache(device, pipelineCache, nullptr);
+    }
+    pipelineCache = VK_NULL_HANDLE;
+}
+
+void PipelineCompiler::submit(Job job) {
+    if (workers.empty())
+        throw std::runtime_error("failed to submit pipeline job, compiler has no threads!");
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(job);
+    }
+    jobAvailable.notify_one();
+}
+
+void PipelineCompiler::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    jobsDone.wait(lock, [this]() { return jobs.empty() && numRunning == 0; });
+}
+
+void PipelineCompiler::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        // queued jobs are drained before stopping
+        jobAvailable.wait(lock, [this]() { return isStopping || !jobs.empty(); });
+        if (jobs.empty())
+            return;
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        ++numRunning;
+        lock.unlock();
+        job();
+        lock.lock();
+        --numRunning;
+        if (jobs.empty() && numRunning == 0)
+            jobsDone.notify_all();
+    }
+}
+
+// empty if there's no file, or it's from another device/driver, driver would reject it anyway but not all do that reliably
+std::vector<char> PipelineCompiler::loadCacheData(VkPhysicalDevice physicalDevice) const {
+    std::vector<char> data;
+    if (cachePath.empty())
+        return data;
+
+    FILE* file = std::fopen(cachePath.c_str(), "rb");
+    if (file == nullptr)
+        return data;
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (size >= static_cast<long>(CACHE_HEADER_SIZE)) {
+        data.resize(static_cast<size_t>(size));
+        if (std::fread(data.data(), 1, data.size(), file) != data.size())
+            data.clear();
+    }
+    std::fclose(file);
+    if (data.empty())
+        return data;
+
+    uint32_t header[4];
+    std::memcpy(header, data.data(), sizeof(header));
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    if (header[0] < CACHE_HEADER_SIZE || header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+        header[2] != properties.vendorID || header[3] != properties.deviceID ||
+        std::memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        std::cerr << "Pipeline cache " << cachePath << " is from another device or driver, ignored\n";
+        data.clear();
+    }
+    return data;
+}
+
+void PipelineCompiler::saveCacheData() const {
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device, pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0)
+        return;
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(device, pipelineCache, &size, data.data()) != VK_SUCCESS)
+        return;
+
+    FILE* file = std::fopen(cachePath.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "failed to write pipeline cache " << cachePath << '\n';
+        return;
+    }
+    std::fwrite(data.data(), 1, size, file);
+    std::fclose(file);
+}
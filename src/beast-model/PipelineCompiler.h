@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Worker threads which create pipelines off the main thread. All pipelines go through one
+ * VkPipelineCache (internally synchronized), so variants sharing shader stages reuse compiled code.
+ *
+ * With a cache path, cache data is loaded at init() if it was written by the same device, and
+ * driver (header's vendor, device, and pipelineCacheUUID match), and saved at cleanup(), which
+ * turns pipeline creation of a warm start mostly into cache hits.
+ *
+ * With zero threads only the cache is created, jobs can't be submitted.
+ */
+class PipelineCompiler {
+public:
+    using Job = std::function<void()>;
+
+    void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t numThreads, const std::string& cachePath);
+    // waits for queued jobs to finish
+    void cleanup();
+
+    VkPipelineCache getCache() const { return pipelineCache; }
+    uint32_t getNumThreads() const { return static_cast<uint32_t>(workers.size()); }
+    bool isCacheLoaded() const { return isLoaded; }
+
+    // job runs on a worker thread, it must not throw
+    void submit(Job job);
+    // block until queued, and running jobs are done
+    void waitIdle();
+
+private:
+    void workerLoop();
+    std::vector<char> loadCacheData(VkPhysicalDevice physicalDevice) const;
+    void saveCacheData() const;
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    std::string cachePath;
+    bool isLoaded = false;
+
+    std::vector<std::thread> workers;
+    std::deque<Job> jobs;
+    uint32_t numRunning = 0;
+    bool isStopping = false;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable jobsDone;
+};
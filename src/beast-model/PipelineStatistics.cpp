@@ -0,0 +1,104 @@
+#include "PipelineStatistics.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+// results are written in order of bits, independent of order listed here
+const VkQueryPipelineStatisticFlags STATISTIC_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+const uint32_t NUM_STATISTICS = 6;
+
+void PipelineStatistics::init(VkDevice device, uint32_t queryCount) {
+    this->device = device;
+    this->queryCount = queryCount;
+    isPending.assign(queryCount, false);
+
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    queryPoolInfo.queryCount = queryCount;
+    queryPoolInfo.pipelineStatistics = STATISTIC_FLAGS;
+
+    if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create pipeline statistics query pool!");
+
+    resetAverage();
+}
+
+void PipelineStatistics::cleanup() {
+    if (queryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(device, queryPool, nullptr);
+    queryPool = VK_NULL_HANDLE;
+    queryCount = 0;
+    isPending.clear();
+}
+
+void PipelineStatistics::cmdReset(VkCommandBuffer commandBuffer, uint32_t query) const {
+    vkCmdResetQueryPool(commandBuffer, queryPool, query, 1);
+}
+
+void PipelineStatistics::cmdBegin(VkCommandBuffer commandBuffer, uint32_t query) const {
+    vkCmdBeginQuery(commandBuffer, queryPool, query, 0);
+}
+
+void PipelineStatistics::cmdEnd(VkCommandBuffer commandBuffer, uint32_t query) const {
+    vkCmdEndQuery(commandBuffer, queryPool, query);
+}
+
+bool PipelineStatistics::collect(uint32_t query, Counters& counters) {
+    if (query >= queryCount || !isPending[query])
+        return false;
+
+    uint64_t results[NUM_STATISTICS] = {};
+    if (vkGetQueryPoolResults(device, queryPool, query, 1, sizeof(results), results, sizeof(results), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+        return false;
+    isPending[query] = false;
+
+    counters.inputAssemblyVertices = results[0];
+    counters.inputAssemblyPrimitives = results[1];
+    counters.vertexShaderInvocations = results[2];
+    counters.clippingInvocations = results[3];
+    counters.clippingPrimitives = results[4];
+    counters.fragmentShaderInvocations = results[5];
+
+    sum.inputAssemblyVertices += counters.inputAssemblyVertices;
+    sum.inputAssemblyPrimitives += counters.inputAssemblyPrimitives;
+    sum.vertexShaderInvocations += counters.vertexShaderInvocations;
+    sum.clippingInvocations += counters.clippingInvocations;
+    sum.clippingPrimitives += counters.clippingPrimitives;
+    sum.fragmentShaderInvocations += counters.fragmentShaderInvocations;
+    ++numSamples;
+    return true;
+}
+
+PipelineStatistics::Counters PipelineStatistics::getAverage() const {
+    Counters average;
+    if (numSamples == 0)
+        return average;
+
+    average.inputAssemblyVertices = sum.inputAssemblyVertices / numSamples;
+    average.inputAssemblyPrimitives = sum.inputAssemblyPrimitives / numSamples;
+    average.vertexShaderInvocations = sum.vertexShaderInvocations / numSamples;
+    average.clippingInvocations = sum.clippingInvocations / numSamples;
+    average.clippingPrimitives = sum.clippingPrimitives / numSamples;
+    average.fragmentShaderInvocations = sum.fragmentShaderInvocations / numSamples;
+    return average;
+}
+
+void PipelineStatistics::resetAverage() {
+    sum = Counters();
+    numSamples = 0;
+}
+
+void PipelineStatistics::print(const char* name, const Counters& counters) {
+    std::printf("Pipeline statistics [%s]\n", name);
+    std::printf("  input assembly      %12llu vertices, %llu primitives\n", static_cast<unsigned long long>(counters.inputAssemblyVertices), static_cast<unsigned long long>(counters.inputAssemblyPrimitives));
+    std::printf("  vertex shader       %12llu invocations\n", static_cast<unsigned long long>(counters.vertexShaderInvocations));
+    std::printf("  clipping            %12llu in, %llu out\n", static_cast<unsigned long long>(counters.clippingInvocations), static_cast<unsigned long long>(counters.clippingPrimitives));
+    std::printf("  fragment shader     %12llu invocations\n", static_cast<unsigned long long>(counters.fragmentShaderInvocations));
+}
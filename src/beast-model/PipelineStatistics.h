@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Pipeline statistics queries, one query per swapchain's image recorded around the draws.
+ * A query's result is collected once the frame that used it is known to be complete
+ * (i.e. right before the image's command buffer is submitted again), and summed until
+ * resetAverage() so the numbers can be reported alongside FPS.
+ *
+ * Requires pipelineStatisticsQuery device feature.
+ */
+class PipelineStatistics {
+public:
+    struct Counters {
+        uint64_t inputAssemblyVertices = 0;
+        uint64_t inputAssemblyPrimitives = 0;
+        uint64_t vertexShaderInvocations = 0;
+        uint64_t clippingInvocations = 0;       // primitives entering clipping
+        uint64_t clippingPrimitives = 0;        // primitives leaving clipping
+        uint64_t fragmentShaderInvocations = 0;
+    };
+
+    void init(VkDevice device, uint32_t queryCount);
+    void cleanup();
+    bool isEnabled() const { return queryPool != VK_NULL_HANDLE; }
+
+    // reset has to be recorded outside of render pass, begin/end within the same subpass
+    void cmdReset(VkCommandBuffer commandBuffer, uint32_t query) const;
+    void cmdBegin(VkCommandBuffer commandBuffer, uint32_t query) const;
+    void cmdEnd(VkCommandBuffer commandBuffer, uint32_t query) const;
+    bool hasQuery(uint32_t query) const { return query < queryCount; }
+
+    // call when command buffer using the query has been submitted
+    void markSubmitted(uint32_t query) { isPending[query] = true; }
+    // false if query has no submitted result which hasn't been collected yet, otherwise result is added to the average
+    bool collect(uint32_t query, Counters& counters);
+
+    Counters getAverage() const;
+    uint32_t getNumSamples() const { return numSamples; }
+    void resetAverage();
+
+    static void print(const char* name, const Counters& counters);
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    uint32_t queryCount = 0;
+    std::vector<bool> isPending;
+
+    Counters sum;
+    uint32_t numSamples = 0;
+};
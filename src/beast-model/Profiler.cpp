@@ -0,0 +1,161 @@
+#include "Profiler.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+Profiler::Profiler() : origin(Clock::now()) {
+}
+
+void Profiler::setEnabled(bool enabled) {
+    // caller is the main thread, register it first so it's labeled as such
+    if (enabled) {
+        std::lock_guard<std::mutex> lock(mutex);
+        getThreadId();
+    }
+    this->enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::addCpuZone(const char* name, Clock::time_point begin, Clock::time_point end) {
+    const double beginUs = std::chrono::duration<double, std::micro>(begin - origin).count();
+    const double durationUs = std::chrono::duration<double, std::micro>(end - begin).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    addEvent(name, getThreadId(), beginUs, durationUs);
+}
+
+uint32_t Profiler::getThreadId() {
+    // small sequential ids read better in trace viewers than hashed thread ids
+    auto it = threadIds.find(std::this_thread::get_id());
+    if (it != threadIds.end())
+        return it->second;
+    const uint32_t id = static_cast<uint32_t>(threadIds.size()) + 1;
+    threadIds.emplace(std::this_thread::get_id(), id);
+    return id;
+}
+
+void Profiler::addEvent(const char* name, uint32_t threadId, double beginUs, double durationUs) {
+    if (events.size() >= MAX_EVENTS) {
+        ++numDropped;
+        return;
+    }
+    events.push_back({name, threadId, beginUs, durationUs});
+}
+
+void Profiler::initGpu(VkDevice device, float timestampPeriod, uint32_t frameCount) {
+    this->device = device;
+    this->frameCount = frameCount;
+    nsPerTick = timestampPeriod;
+    isPending.assign(frameCount, false);
+
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = frameCount * 2;
+
+    if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create profiler query pool!");
+}
+
+void Profiler::cleanupGpu() {
+    if (queryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(device, queryPool, nullptr);
+    queryPool = VK_NULL_HANDLE;
+    frameCount = 0;
+    isPending.clear();
+}
+
+void Profiler::calibrateGpuClock(VkQueue queue, VkCommandPool commandPool) {
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate profiler calibration command buffer!");
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 1);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    // timestamp is written somewhere between submit, and idle, take the middle
+    const Clock::time_point submitTime = Clock::now();
+    vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    vkQueueWaitIdle(queue);
+    const Clock::time_point idleTime = Clock::now();
+
+    uint64_t timestamp = 0;
+    if (vkGetQueryPoolResults(device, queryPool, 0, 1, sizeof(timestamp), &timestamp, sizeof(timestamp), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+        const double cpuUs = std::chrono::duration<double, std::micro>(submitTime - origin).count() + std::chrono::duration<double, std::micro>(idleTime - submitTime).count() * 0.5;
+        gpuOffsetUs = cpuUs - timestamp * nsPerTick / 1000.0;
+        isCalibrated = true;
+    }
+
+    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+}
+
+void Profiler::cmdBeginGpuFrame(VkCommandBuffer commandBuffer, uint32_t frame) const {
+    vkCmdResetQueryPool(commandBuffer, queryPool, frame * 2, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, frame * 2);
+}
+
+void Profiler::cmdEndGpuFrame(VkCommandBuffer commandBuffer, uint32_t frame) const {
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, frame * 2 + 1);
+}
+
+void Profiler::markSubmitted(uint32_t frame) {
+    if (frame < frameCount)
+        isPending[frame] = true;
+}
+
+void Profiler::collectGpuFrame(uint32_t frame) {
+    if (frame >= frameCount || !isPending[frame] || !isCalibrated)
+        return;
+
+    uint64_t timestamps[2] = {};
+    if (vkGetQueryPoolResults(device, queryPool, frame * 2, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+        return;
+    isPending[frame] = false;
+
+    const double beginUs = timestamps[0] * nsPerTick / 1000.0 + gpuOffsetUs;
+    const double durationUs = (timestamps[1] - timestamps[0]) * nsPerTick / 1000.0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    addEvent("gpu frame", GPU_THREAD_ID, beginUs, durationUs);
+}
+
+bool Profiler::writeTrace() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    FILE* file = std::fopen(outputPath.c_str(), "w");
+    if (file == nullptr)
+        return false;
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"GPU graphics queue\"}}", GPU_THREAD_ID);
+    for (const auto& thread : threadIds)
+        std::fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}", thread.second, thread.second == 1 ? "main" : "worker", thread.second);
+    for (const Event& event : events)
+        std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.name, event.threadId == GPU_THREAD_ID ? "gpu" : "cpu", event.threadId, event.beginUs, event.durationUs);
+    std::fprintf(file, "\n]}\n");
+    const bool isWritten = std::fclose(file) == 0;
+
+    std::printf("Trace: %zu event(s) written to %s", events.size(), outputPath.c_str());
+    if (numDropped > 0)
+        std::printf(", %zu dropped", numDropped);
+    std::printf("\n");
+
+    events.clear();
+    numDropped = 0;
+    return isWritten;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Scoped CPU zones, and GPU timestamp ranges written as Chrome trace-event JSON,
+ * which loads in chrome://tracing, and Perfetto (ui.perfetto.dev).
+ *
+ * CPU zones can be recorded from any thread. When disabled a zone costs a relaxed
+ * atomic load, zone names have to be string literals (pointers are kept).
+ *
+ * GPU ranges come from a pair of timestamps around each frame's command buffer,
+ * one pair per swapchain's image, collected like pipeline statistics once the frame
+ * is known to be complete. GPU ticks are mapped onto CPU time with an offset
+ * measured once by calibrateGpuClock(), good to within a submission's latency.
+ * Calibration idles the queue, so it should only be done once profiling is enabled.
+ */
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Profiler();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    void setOutputPath(const std::string& path) { outputPath = path; }
+    const std::string& getOutputPath() const { return outputPath; }
+
+    void addCpuZone(const char* name, Clock::time_point begin, Clock::time_point end);
+
+    // GPU ranges require timestamp support on the queue family (timestampValidBits > 0)
+    void initGpu(VkDevice device, float timestampPeriod, uint32_t frameCount);
+    void cleanupGpu();
+    bool hasGpu() const { return queryPool != VK_NULL_HANDLE; }
+    void calibrateGpuClock(VkQueue queue, VkCommandPool commandPool);
+    bool isGpuClockCalibrated() const { return isCalibrated; }
+    // begin has to be recorded outside of render pass (resets queries of the frame)
+    void cmdBeginGpuFrame(VkCommandBuffer commandBuffer, uint32_t frame) const;
+    void cmdEndGpuFrame(VkCommandBuffer commandBuffer, uint32_t frame) const;
+    void markSubmitted(uint32_t frame);
+    void collectGpuFrame(uint32_t frame);
+
+    // writes all recorded events, and clears them, false if file couldn't be written
+    bool writeTrace();
+
+private:
+    static const size_t MAX_EVENTS = 1 << 20;     // ~32 MB, later events are dropped
+    static const uint32_t GPU_THREAD_ID = 1000;
+
+    struct Event {
+        const char* name;
+        uint32_t threadId;
+        double beginUs;     // since origin
+        double durationUs;
+    };
+
+    uint32_t getThreadId();
+    void addEvent(const char* name, uint32_t threadId, double beginUs, double durationUs);
+
+    std::atomic<bool> enabled{false};
+    std::string outputPath = "trace.json";
+    Clock::time_point origin;
+
+    std::mutex mutex;   // guards everything below
+    std::vector<Event> events;
+    size_t numDropped = 0;
+    std::unordered_map<std::thread::id, uint32_t> threadIds;
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueryPool queryPool = VK_NULL_HANDLE;     // 2 timestamps per frame
+    uint32_t frameCount = 0;
+    std::vector<bool> isPending;
+    double nsPerTick = 1.0;
+    double gpuOffsetUs = 0.0;     // CPU time (since origin) minus GPU time, both in microseconds
+    bool isCalibrated = false;
+};
+
+// records a CPU zone from construction until destruction, or next()
+class ProfileZone {
+public:
+    ProfileZone(Profiler& profiler, const char* name) : profiler(profiler), name(name) {
+        if (profiler.isEnabled())
+            begin = Profiler::Clock::now();
+        else
+            this->name = nullptr;
+    }
+    ~ProfileZone() { end(); }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+    // end current zone, and start another one right away
+    void next(const char* nextName) {
+        end();
+        if (profiler.isEnabled()) {
+            name = nextName;
+            begin = Profiler::Clock::now();
+        }
+    }
+
+private:
+    // zone still open when profiling got disabled is dropped, trace may already be written
+    void end() {
+        if (name != nullptr && profiler.isEnabled())
+            profiler.addCpuZone(name, begin, Profiler::Clock::now());
+        name = nullptr;
+    }
+
+    Profiler& profiler;
+    const char* name;
+    Profiler::Clock::time_point begin;
+};
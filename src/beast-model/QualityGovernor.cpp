@@ -0,0 +1,50 @@
+#include "QualityGovernor.h"
+
+void QualityGovernor::init(VkSampleCountFlagBits samples, bool sampleShading, double budgetMs) {
+    this->budgetMs = budgetMs;
+    setCeiling(samples, sampleShading);
+    smoothedMs = 0.0;
+}
+
+bool QualityGovernor::update(double frameMs) {
+    if (!isEnabled())
+        return false;
+
+    smoothedMs = smoothedMs > 0.0 ? smoothedMs + (frameMs - smoothedMs) * SMOOTHING : frameMs;
+
+    if (cooldownFrames > 0) {
+        --cooldownFrames;
+        return false;
+    }
+
+    overBudgetFrames = smoothedMs > budgetMs ? overBudgetFrames + 1 : 0;
+    underBudgetFrames = smoothedMs < budgetMs * HEADROOM ? underBudgetFrames + 1 : 0;
+
+    if (overBudgetFrames >= DOWN_FRAMES && levelIndex + 1 < levels.size()) {
+        setLevelIndex(levelIndex + 1);
+        return true;
+    }
+    if (underBudgetFrames >= UP_FRAMES && levelIndex > 0) {
+        setLevelIndex(levelIndex - 1);
+        return true;
+    }
+    return false;
+}
+
+void QualityGovernor::setCeiling(VkSampleCountFlagBits samples, bool sampleShading) {
+    // sample shading makes no difference at 1x
+    levels.clear();
+    if (sampleShading && samples > VK_SAMPLE_COUNT_1_BIT)
+        levels.push_back({samples, true});
+    for (uint32_t s=samples; s>=VK_SAMPLE_COUNT_1_BIT; s>>=1)
+        levels.push_back({static_cast<VkSampleCountFlagBits>(s), false});
+
+    setLevelIndex(0);
+}
+
+void QualityGovernor::setLevelIndex(size_t index) {
+    levelIndex = index;
+    overBudgetFrames = 0;
+    underBudgetFrames = 0;
+    cooldownFrames = COOLDOWN_FRAMES;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Steps rendering quality (MSAA sample count, and sample shading) down when frames
+ * take longer than a budget, and back up once there's enough headroom.
+ *
+ * Levels are ordered from the highest quality, which is what the user configured and is
+ * never exceeded: sample shading goes first as it multiplies fragment shader invocations
+ * by sample count, then sample count is halved down to 1x. Decisions are based on a smoothed frame time, stepping down reacts
+ * within a few frames, stepping up only after a longer stretch under budget so
+ * quality doesn't oscillate around the budget. Nothing changes during a cooldown
+ * after each step while the new level settles.
+ *
+ * Frame time is the CPU interval between frames, so with FIFO it can't go below
+ * the refresh interval; budget should be above that, or use mailbox/immediate.
+ */
+class QualityGovernor {
+public:
+    struct Level {
+        VkSampleCountFlagBits samples;
+        bool sampleShading;
+    };
+
+    // starts at the top level, given by samples, and sampleShading
+    void init(VkSampleCountFlagBits samples, bool sampleShading, double budgetMs);
+    bool isEnabled() const { return budgetMs > 0.0; }
+
+    // call once per frame, true if level changed and should be applied
+    bool update(double frameMs);
+
+    const Level& getLevel() const { return levels[levelIndex]; }
+    // settings changed by the user (e.g. by key press) become the new top level, and current one
+    void setCeiling(VkSampleCountFlagBits samples, bool sampleShading);
+
+private:
+    static const uint32_t DOWN_FRAMES = 10;         // consecutive frames over budget to step down
+    static const uint32_t UP_FRAMES = 180;          // consecutive frames with headroom to step up
+    static const uint32_t COOLDOWN_FRAMES = 60;     // after each step
+    static constexpr double HEADROOM = 0.7;         // fraction of budget considered to have room for a higher level
+    static constexpr double SMOOTHING = 0.1;        // weight of newest sample in moving average
+
+    void setLevelIndex(size_t index);
+
+    std::vector<Level> levels;
+    size_t levelIndex = 0;
+    double budgetMs = 0.0;
+    double smoothedMs = 0.0;
+    uint32_t overBudgetFrames = 0;
+    uint32_t underBudgetFrames = 0;
+    uint32_t cooldownFrames = 0;
+};
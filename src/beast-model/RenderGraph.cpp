@@ -0,0 +1,593 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+// access bits that modify memory, anything else is a read
+static const VkAccessFlags WRITE_ACCESS_MASK =
+    VK_ACCESS_SHADER_WRITE_BIT |
+    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_TRANSFER_WRITE_BIT |
+    VK_ACCESS_HOST_WRITE_BIT |
+    VK_ACCESS_MEMORY_WRITE_BIT;
+
+RenderGraph::RenderGraph(VkDevice device, VkPhysicalDevice physicalDevice, MemoryTracker* memoryTracker)
+    : device(device)
+    , physicalDevice(physicalDevice)
+    , memoryTracker(memoryTracker) {
+}
+
+RenderGraph::~RenderGraph() {
+    for (const Resource& resource : resources) {
+        if (!resource.isTransient)
+            continue;
+        if (resource.imageView != VK_NULL_HANDLE)
+            vkDestroyImageView(device, resource.imageView, nullptr);
+        if (resource.image != VK_NULL_HANDLE)
+            vkDestroyImage(device, resource.image, nullptr);
+    }
+
+    for (VkDeviceMemory memory : memoryBlocks) {
+        if (memoryTracker != nullptr)
+            memoryTracker->free(device, memory);
+        else
+            vkFreeMemory(device, memory, nullptr);
+    }
+}
+
+RenderGraph::ResourceHandle RenderGraph::importImage(const std::string& name, VkImage image, VkImageAspectFlags aspect, uint32_t mipLevels, Usage currentUsage) {
+    Resource resource = {};
+    resource.name = name;
+    resource.isImage = true;
+    resource.isTransient = false;
+    resource.image = image;
+    resource.imageView = VK_NULL_HANDLE;
+    resource.buffer = VK_NULL_HANDLE;
+    resource.aspect = aspect;
+    resource.mipLevels = mipLevels;
+    resource.initialUsage = currentUsage;
+    resource.finalUsage = Usage::None;
+
+    resources.push_back(resource);
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::importBuffer(const std::string& name, VkBuffer buffer, Usage currentUsage) {
+    Resource resource = {};
+    resource.name = name;
+    resource.isImage = false;
+    resource.isTransient = false;
+    resource.image = VK_NULL_HANDLE;
+    resource.imageView = VK_NULL_HANDLE;
+    resource.buffer = buffer;
+    resource.initialUsage = currentUsage;
+    resource.finalUsage = Usage::None;
+
+    resources.push_back(resource);
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::createTransientImage(const std::string& name, const ImageDesc& desc) {
+    Resource resource = {};
+    resource.name = name;
+    resource.isImage = true;
+    resource.isTransient = true;
+    resource.image = VK_NULL_HANDLE;
+    resource.imageView = VK_NULL_HANDLE;
+    resource.buffer = VK_NULL_HANDLE;
+    resource.aspect = desc.aspect;
+    resource.mipLevels = 1;
+    resource.desc = desc;
+    // contents of transient image are never preserved between executions
+    resource.initialUsage = Usage::None;
+    resource.finalUsage = Usage::None;
+
+    resources.push_back(resource);
+    return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+RenderGraph::PassHandle RenderGraph::addPass(const std::string& name, std::function<void(VkCommandBuffer)> record) {
+    Pass pass = {};
+    pass.name = name;
+    pass.record = record;
+    pass.hasSideEffects = false;
+    pass.isLive = false;
+
+    passes.push_back(pass);
+    return static_cast<PassHandle>(passes.size() - 1);
+}
+
+void RenderGraph::read(PassHandle pass, ResourceHandle resource, Usage usage) {
+    addAccess(pass, resource, usage);
+}
+
+void RenderGraph::write(PassHandle pass, ResourceHandle resource, Usage usage) {
+    addAccess(pass, resource, usage);
+}
+
+void RenderGraph::attachment(PassHandle pass, ResourceHandle resource, Usage usage, Usage exitUsage) {
+    addAccess(pass, resource, usage);
+
+    Access* access = findAccess(pass, resource);
+    access->isRenderPassAttachment = true;
+    access->hasExitUsage = true;
+    access->exitUsage = exitUsage;
+}
+
+void RenderGraph::setExitUsage(PassHandle pass, ResourceHandle resource, Usage exitUsage) {
+    Access* access = findAccess(pass, resource);
+    if (access == nullptr)
+        throw std::runtime_error("render graph: exit usage set for resource not accessed by pass!");
+
+    access->hasExitUsage = true;
+    access->exitUsage = exitUsage;
+}
+
+void RenderGraph::setSideEffects(PassHandle pass) {
+    passes[pass].hasSideEffects = true;
+}
+
+void RenderGraph::setFinalUsage(ResourceHandle resource, Usage usage) {
+    resources[resource].finalUsage = usage;
+    resources[resource].isOutput = true;
+}
+
+void RenderGraph::addAccess(PassHandle pass, ResourceHandle resource, Usage usage) {
+    const UsageInfo info = getUsageInfo(usage, resources[resource].aspect);
+
+    // multiple accesses to the same resource within a pass are merged into a single one
+    Access* access = findAccess(pass, resource);
+    if (access != nullptr) {
+        if (resources[resource].isImage && access->info.layout != info.layout)
+            throw std::runtime_error("render graph: conflicting image layouts within a pass for " + resources[resource].name);
+
+        access->info.stages |= info.stages;
+        access->info.access |= info.access;
+        access->info.isWrite = access->info.isWrite || info.isWrite;
+        return;
+    }
+
+    Access newAccess = {};
+    newAccess.resource = resource;
+    newAccess.info = info;
+    newAccess.exitUsage = Usage::None;
+    newAccess.isRenderPassAttachment = false;
+    newAccess.hasExitUsage = false;
+    passes[pass].accesses.push_back(newAccess);
+}
+
+RenderGraph::Access* RenderGraph::findAccess(PassHandle pass, ResourceHandle resource) {
+    for (Access& access : passes[pass].accesses) {
+        if (access.resource == resource)
+            return &access;
+    }
+    return nullptr;
+}
+
+// aspect only matters for depth usages, layouts of depth only images don't cover stencil (separate depth/stencil layouts)
+RenderGraph::UsageInfo RenderGraph::getUsageInfo(Usage usage, VkImageAspectFlags aspect) {
+    const bool hasStencil = (aspect & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+    switch (usage) {
+        case Usage::None:
+            return { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED, false };
+        case Usage::TransferSrc:
+            return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false };
+        case Usage::TransferDst:
+            return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true };
+        case Usage::VertexBufferRead:
+            return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+        case Usage::IndexBufferRead:
+            return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+        case Usage::UniformBufferRead:
+            return { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+        case Usage::VertexShaderRead:
+            return { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+        case Usage::FragmentShaderRead:
+            return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+        case Usage::ComputeShaderRead:
+            return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+        case Usage::ComputeShaderWrite:
+            return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true };
+        case Usage::ColorAttachmentWrite:
+            return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true };
+        case Usage::DepthAttachmentWrite:
+            return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                     hasStencil ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, true };
+        case Usage::DepthAttachmentRead:
+            return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                     hasStencil ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, false };
+        case Usage::Present:
+            return { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false };
+        case Usage::HostRead:
+            return { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
+    }
+
+    throw std::runtime_error("render graph: unknown resource usage!");
+}
+
+// state of a resource imported in the specified usage, prior work is assumed to be submitted already
+RenderGraph::ResourceState RenderGraph::getInitialState(Usage usage, VkImageAspectFlags aspect) {
+    ResourceState state = {};
+    if (usage == Usage::None) {
+        state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        return state;
+    }
+
+    const UsageInfo info = getUsageInfo(usage, aspect);
+    state.layout = info.layout;
+    state.syncStages = info.stages;
+    if (info.isWrite) {
+        state.writeStages = info.stages;
+        state.pendingWriteAccess = info.access & WRITE_ACCESS_MASK;
+    }
+    return state;
+}
+
+void RenderGraph::addBarrier(BarrierBatch& batch, const Resource& resource, ResourceState& state, const UsageInfo& info) {
+    const bool isLayoutChange = resource.isImage && state.layout != info.layout;
+    bool isNeeded = false;
+    VkPipelineStageFlags srcStages = 0;
+
+    if (info.isWrite || isLayoutChange) {
+        // write-after-read/write, or layout transition, wait for every access since last write
+        srcStages = state.syncStages | state.writeStages;
+        isNeeded = srcStages != 0 || isLayoutChange;
+    }
+    else if (state.writeStages != 0 &&
+             ((state.visibleStages & info.stages) != info.stages || (state.visibleAccess & info.access) != info.access)) {
+        // read-after-write, and the write isn't visible to this stage yet
+        srcStages = state.writeStages;
+        isNeeded = true;
+    }
+
+    if (isNeeded) {
+        if (srcStages == 0)
+            srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+        if (resource.isImage) {
+            VkImageMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = state.pendingWriteAccess;
+            barrier.dstAccessMask = info.access;
+            barrier.oldLayout = state.layout;
+            barrier.newLayout = info.layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = resource.image;
+            barrier.subresourceRange.aspectMask = resource.aspect;
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = resource.mipLevels;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+            batch.imageBarriers.push_back(barrier);
+        }
+        else {
+            VkBufferMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = state.pendingWriteAccess;
+            barrier.dstAccessMask = info.access;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = resource.buffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            batch.bufferBarriers.push_back(barrier);
+        }
+
+        batch.srcStages |= srcStages;
+        batch.dstStages |= info.stages;
+    }
+
+    if (info.isWrite || isLayoutChange) {
+        // layout transition acts as a write, later reads have to be ordered after it
+        state.writeStages = info.stages;
+        state.syncStages = info.stages;
+        state.pendingWriteAccess = info.isWrite ? (info.access & WRITE_ACCESS_MASK) : 0;
+        state.visibleStages = info.isWrite ? 0 : info.stages;
+        state.visibleAccess = info.isWrite ? 0 : info.access;
+        state.layout = resource.isImage ? info.layout : state.layout;
+    }
+    else {
+        if (isNeeded) {
+            state.pendingWriteAccess = 0;
+            state.visibleStages |= info.stages;
+            state.visibleAccess |= info.access;
+        }
+        state.syncStages |= info.stages;
+    }
+}
+
+void RenderGraph::applyExitUsage(ResourceState& state, Usage exitUsage, VkImageAspectFlags aspect) {
+    const UsageInfo info = getUsageInfo(exitUsage, aspect);
+    state.layout = info.layout;
+    state.writeStages = info.stages;
+    state.syncStages = info.stages;
+    // for read usage, pass has made its writes available, and visible through its own barriers
+    state.pendingWriteAccess = info.isWrite ? (info.access & WRITE_ACCESS_MASK) : 0;
+    state.visibleStages = info.isWrite ? 0 : info.stages;
+    state.visibleAccess = info.isWrite ? 0 : info.access;
+}
+
+// walk passes backwards, a pass is live only if it writes something consumed by a later live pass, or an output
+void RenderGraph::cullPasses() {
+    for (Resource& resource : resources)
+        resource.isNeeded = resource.isOutput;
+
+    for (int i=static_cast<int>(passes.size())-1; i>=0; --i) {
+        Pass& pass = passes[i];
+        pass.isLive = pass.hasSideEffects;
+
+        for (const Access& access : pass.accesses) {
+            if (access.info.isWrite && resources[access.resource].isNeeded)
+                pass.isLive = true;
+        }
+
+        if (pass.isLive) {
+            for (const Access& access : pass.accesses)
+                resources[access.resource].isNeeded = true;
+        }
+        else {
+            ++stats.numCulledPasses;
+        }
+    }
+}
+
+void RenderGraph::compile() {
+    if (isCompiled)
+        return;
+
+    stats = Stats();
+    stats.numPasses = static_cast<uint32_t>(passes.size());
+
+    cullPasses();
+
+    // lifetime of each resource over live passes
+    for (Resource& resource : resources) {
+        resource.firstPass = -1;
+        resource.lastPass = -1;
+    }
+    for (size_t i=0; i<passes.size(); ++i) {
+        if (!passes[i].isLive)
+            continue;
+        for (const Access& access : passes[i].accesses) {
+            Resource& resource = resources[access.resource];
+            if (resource.firstPass < 0)
+                resource.firstPass = static_cast<int>(i);
+            resource.lastPass = static_cast<int>(i);
+        }
+    }
+
+    createTransientResources();
+
+    // compute barriers for each live pass
+    std::vector<ResourceState> states(resources.size());
+    for (size_t i=0; i<resources.size(); ++i)
+        states[i] = getInitialState(resources[i].initialUsage, resources[i].aspect);
+
+    // last transient image which occupied each memory block, aliased image has to wait for it
+    std::vector<int> blockOccupant(memoryBlocks.size(), -1);
+
+    passBarriers.assign(passes.size(), BarrierBatch());
+    for (size_t i=0; i<passes.size(); ++i) {
+        if (!passes[i].isLive)
+            continue;
+
+        for (const Access& access : passes[i].accesses) {
+            Resource& resource = resources[access.resource];
+            ResourceState& state = states[access.resource];
+
+            if (resource.isTransient && resource.firstPass == static_cast<int>(i)) {
+                int& occupant = blockOccupant[resource.memoryBlock];
+                if (occupant >= 0) {
+                    state.syncStages = states[occupant].syncStages | states[occupant].writeStages;
+                    state.pendingWriteAccess = states[occupant].pendingWriteAccess;
+                }
+                occupant = static_cast<int>(access.resource);
+            }
+
+            // render pass performs its own layout transitions, and synchronization via subpass dependencies
+            if (!access.isRenderPassAttachment)
+                addBarrier(passBarriers[i], resource, state, access.info);
+
+            if (access.hasExitUsage)
+                applyExitUsage(state, access.exitUsage, resource.aspect);
+        }
+    }
+
+    // transition outputs to their final usage
+    finalBarriers = BarrierBatch();
+    for (size_t i=0; i<resources.size(); ++i) {
+        if (resources[i].isOutput && resources[i].finalUsage != Usage::None)
+            addBarrier(finalBarriers, resources[i], states[i], getUsageInfo(resources[i].finalUsage, resources[i].aspect));
+    }
+
+    for (const BarrierBatch& batch : passBarriers) {
+        if (!batch.imageBarriers.empty() || !batch.bufferBarriers.empty())
+            ++stats.numBarrierBatches;
+        stats.numImageBarriers += static_cast<uint32_t>(batch.imageBarriers.size());
+        stats.numBufferBarriers += static_cast<uint32_t>(batch.bufferBarriers.size());
+    }
+    if (!finalBarriers.imageBarriers.empty() || !finalBarriers.bufferBarriers.empty())
+        ++stats.numBarrierBatches;
+    stats.numImageBarriers += static_cast<uint32_t>(finalBarriers.imageBarriers.size());
+    stats.numBufferBarriers += static_cast<uint32_t>(finalBarriers.bufferBarriers.size());
+
+    isCompiled = true;
+}
+
+void RenderGraph::createTransientResources() {
+    struct MemoryBlock {
+        VkDeviceSize size;
+        uint32_t memoryTypeBits;
+        std::vector<std::pair<int, int>> lifetimes;
+    };
+
+    std::vector<ResourceHandle> transients;
+    std::vector<VkMemoryRequirements> requirements(resources.size());
+
+    for (size_t i=0; i<resources.size(); ++i) {
+        Resource& resource = resources[i];
+        if (!resource.isTransient || resource.firstPass < 0)
+            continue;
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = resource.desc.extent.width;
+        imageInfo.extent.height = resource.desc.extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = resource.desc.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = resource.desc.usage;
+        imageInfo.samples = resource.desc.samples;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS)
+            throw std::runtime_error("render graph: failed to create transient image " + resource.name);
+
+        vkGetImageMemoryRequirements(device, resource.image, &requirements[i]);
+        transients.push_back(static_cast<ResourceHandle>(i));
+        ++stats.numTransientImages;
+    }
+
+    // greedy first-fit from largest to smallest, a block is shared by images with disjoint lifetimes
+    std::sort(transients.begin(), transients.end(), [&](ResourceHandle a, ResourceHandle b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    std::vector<MemoryBlock> blocks;
+    VkDeviceSize requestedBytes = 0;
+    for (ResourceHandle handle : transients) {
+        Resource& resource = resources[handle];
+        const VkMemoryRequirements& req = requirements[handle];
+        requestedBytes += req.size;
+
+        bool isPlaced = false;
+        for (size_t b=0; b<blocks.size() && !isPlaced; ++b) {
+            MemoryBlock& block = blocks[b];
+            if ((block.memoryTypeBits & req.memoryTypeBits) == 0 || req.size > block.size)
+                continue;
+
+            bool isOverlapped = false;
+            for (const auto& lifetime : block.lifetimes) {
+                if (resource.firstPass <= lifetime.second && lifetime.first <= resource.lastPass) {
+                    isOverlapped = true;
+                    break;
+                }
+            }
+            if (isOverlapped)
+                continue;
+
+            block.memoryTypeBits &= req.memoryTypeBits;
+            block.lifetimes.push_back(std::make_pair(resource.firstPass, resource.lastPass));
+            resource.memoryBlock = static_cast<uint32_t>(b);
+            isPlaced = true;
+        }
+
+        if (!isPlaced) {
+            MemoryBlock block;
+            block.size = req.size;
+            block.memoryTypeBits = req.memoryTypeBits;
+            block.lifetimes.push_back(std::make_pair(resource.firstPass, resource.lastPass));
+            resource.memoryBlock = static_cast<uint32_t>(blocks.size());
+            blocks.push_back(block);
+        }
+    }
+
+    for (const MemoryBlock& block : blocks) {
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block.size;
+        allocInfo.memoryTypeIndex = findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        VkDeviceMemory memory;
+        const VkResult result = memoryTracker != nullptr ? memoryTracker->allocate(device, allocInfo, MemoryTag::Transient, memory) : vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("render graph: failed to allocate transient memory!");
+
+        memoryBlocks.push_back(memory);
+        stats.transientBytes += block.size;
+    }
+    stats.numMemoryBlocks = static_cast<uint32_t>(blocks.size());
+    stats.aliasedBytesSaved = requestedBytes - stats.transientBytes;
+
+    for (ResourceHandle handle : transients) {
+        Resource& resource = resources[handle];
+        vkBindImageMemory(device, resource.image, memoryBlocks[resource.memoryBlock], 0);
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = resource.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = resource.desc.format;
+        viewInfo.subresourceRange.aspectMask = resource.aspect;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &resource.imageView) != VK_SUCCESS)
+            throw std::runtime_error("render graph: failed to create transient image view " + resource.name);
+    }
+}
+
+uint32_t RenderGraph::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (uint32_t i=0; i<memProperties.memoryTypeCount; ++i) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            return i;
+    }
+
+    throw std::runtime_error("render graph: failed to find suitable memory type!");
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) {
+    if (batch.imageBarriers.empty() && batch.bufferBarriers.empty())
+        return;
+
+    vkCmdPipelineBarrier(commandBuffer,
+            batch.srcStages, batch.dstStages, 0,
+            0, nullptr,
+            static_cast<uint32_t>(batch.bufferBarriers.size()), batch.bufferBarriers.data(),
+            static_cast<uint32_t>(batch.imageBarriers.size()), batch.imageBarriers.data());
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+    if (!isCompiled)
+        compile();
+
+    for (size_t i=0; i<passes.size(); ++i) {
+        if (!passes[i].isLive)
+            continue;
+
+        recordBarriers(commandBuffer, passBarriers[i]);
+        passes[i].record(commandBuffer);
+    }
+
+    recordBarriers(commandBuffer, finalBarriers);
+}
+
+VkImage RenderGraph::getImage(ResourceHandle resource) const {
+    return resources[resource].image;
+}
+
+VkImageView RenderGraph::getImageView(ResourceHandle resource) const {
+    return resources[resource].imageView;
+}
+
+void RenderGraph::printStats(const char* name) const {
+    std::cout << "Render graph [" << name << "]\n";
+    std::cout << "  Passes: " << stats.numPasses << " (culled: " << stats.numCulledPasses << ")\n";
+    std::cout << "  Barrier batches: " << stats.numBarrierBatches << " (image barriers: " << stats.numImageBarriers << ", buffer barriers: " << stats.numBufferBarriers << ")\n";
+    if (stats.numTransientImages > 0) {
+        std::cout << "  Transient images: " << stats.numTransientImages << " in " << stats.numMemoryBlocks << " memory block(s), "
+                  << stats.transientBytes / 1024 << " KB allocated, " << stats.aliasedBytesSaved / 1024 << " KB saved by aliasing\n";
+    }
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "MemoryTracker.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * Minimal frame graph.
+ * Passes declare which resources they read, and write with a usage, the graph then
+ * - culls passes whose results are never consumed
+ * - computes one batched vkCmdPipelineBarrier() per pass with stage/access masks, and
+ *   layout transitions derived from previous, and next usage of each resource
+ * - creates transient images, and aliases their memory when lifetimes don't overlap
+ *
+ * Usage
+ *  1. import existing resources, or create transient images
+ *  2. add passes, and declare their reads/writes
+ *  3. set final usage of resources that outlive the graph (outputs)
+ *  4. compile() once, execute() into a command buffer (can be done multiple times)
+ */
+class RenderGraph {
+public:
+    typedef uint32_t ResourceHandle;
+    typedef uint32_t PassHandle;
+
+    enum class Usage {
+        None,                   // not accessed yet, contents undefined
+        TransferSrc,
+        TransferDst,
+        VertexBufferRead,
+        IndexBufferRead,
+        UniformBufferRead,
+        VertexShaderRead,
+        FragmentShaderRead,
+        ComputeShaderRead,
+        ComputeShaderWrite,
+        ColorAttachmentWrite,
+        DepthAttachmentWrite,   // depth only layouts unless image's aspect includes stencil, as render pass does
+        DepthAttachmentRead,
+        Present,
+        HostRead                // mapped, and read by CPU once the submission completed
+    };
+
+    struct ImageDesc {
+        VkExtent2D extent;
+        VkFormat format;
+        VkImageUsageFlags usage;
+        VkSampleCountFlagBits samples;
+        VkImageAspectFlags aspect;
+    };
+
+    struct Stats {
+        uint32_t numPasses = 0;
+        uint32_t numCulledPasses = 0;
+        uint32_t numBarrierBatches = 0;     // number of vkCmdPipelineBarrier() calls
+        uint32_t numImageBarriers = 0;
+        uint32_t numBufferBarriers = 0;
+        uint32_t numTransientImages = 0;
+        uint32_t numMemoryBlocks = 0;       // device memory allocations backing transient images
+        VkDeviceSize transientBytes = 0;    // memory actually allocated for transient images
+        VkDeviceSize aliasedBytesSaved = 0; // memory saved by aliasing
+    };
+
+    // transient memory is accounted as MemoryTag::Transient if memoryTracker is given
+    RenderGraph(VkDevice device, VkPhysicalDevice physicalDevice, MemoryTracker* memoryTracker = nullptr);
+    ~RenderGraph();
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    ResourceHandle importImage(const std::string& name, VkImage image, VkImageAspectFlags aspect, uint32_t mipLevels, Usage currentUsage);
+    ResourceHandle importBuffer(const std::string& name, VkBuffer buffer, Usage currentUsage);
+    ResourceHandle createTransientImage(const std::string& name, const ImageDesc& desc);
+
+    PassHandle addPass(const std::string& name, std::function<void(VkCommandBuffer)> record);
+    void read(PassHandle pass, ResourceHandle resource, Usage usage);
+    void write(PassHandle pass, ResourceHandle resource, Usage usage);
+    // attachment whose layout transitions are performed by the render pass itself (initialLayout, finalLayout)
+    void attachment(PassHandle pass, ResourceHandle resource, Usage usage, Usage exitUsage);
+    // pass performs its own internal barriers, and leaves resource in exitUsage
+    void setExitUsage(PassHandle pass, ResourceHandle resource, Usage exitUsage);
+    // pass is never culled
+    void setSideEffects(PassHandle pass);
+
+    // resource outlives the graph, it will be transitioned to this usage at the end
+    void setFinalUsage(ResourceHandle resource, Usage usage);
+
+    void compile();
+    void execute(VkCommandBuffer commandBuffer);
+
+    VkImage getImage(ResourceHandle resource) const;
+    VkImageView getImageView(ResourceHandle resource) const;
+    const Stats& getStats() const { return stats; }
+    void printStats(const char* name) const;
+
+private:
+    struct UsageInfo {
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        VkImageLayout layout;
+        bool isWrite;
+    };
+
+    struct Resource {
+        std::string name;
+        bool isImage;
+        bool isTransient;
+        VkImage image;
+        VkImageView imageView;
+        VkBuffer buffer;
+        VkImageAspectFlags aspect;
+        uint32_t mipLevels;
+        ImageDesc desc;
+        Usage initialUsage;
+        Usage finalUsage;
+        bool isOutput;
+        bool isNeeded;
+        // lifetime over live passes, for aliasing of transient images
+        int firstPass;
+        int lastPass;
+        uint32_t memoryBlock;
+    };
+
+    struct Access {
+        ResourceHandle resource;
+        UsageInfo info;             // combined if a pass accesses a resource in multiple ways
+        Usage exitUsage;
+        bool isRenderPassAttachment;
+        bool hasExitUsage;
+    };
+
+    struct Pass {
+        std::string name;
+        std::function<void(VkCommandBuffer)> record;
+        std::vector<Access> accesses;
+        bool hasSideEffects;
+        bool isLive;
+    };
+
+    // tracked synchronization state of a resource while walking through passes
+    struct ResourceState {
+        VkImageLayout layout;
+        VkPipelineStageFlags writeStages;      // stages of last write (or layout transition)
+        VkAccessFlags pendingWriteAccess;      // writes not made available yet
+        VkPipelineStageFlags syncStages;       // all stages accessing resource since last write, next write has to wait for them
+        VkPipelineStageFlags visibleStages;    // stages to which last write has been made visible
+        VkAccessFlags visibleAccess;
+    };
+
+    struct BarrierBatch {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+        std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    };
+
+    static UsageInfo getUsageInfo(Usage usage, VkImageAspectFlags aspect);
+    static ResourceState getInitialState(Usage usage, VkImageAspectFlags aspect);
+    void addBarrier(BarrierBatch& batch, const Resource& resource, ResourceState& state, const UsageInfo& info);
+    void applyExitUsage(ResourceState& state, Usage exitUsage, VkImageAspectFlags aspect);
+    void cullPasses();
+    void createTransientResources();
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch);
+    void addAccess(PassHandle pass, ResourceHandle resource, Usage usage);
+    Access* findAccess(PassHandle pass, ResourceHandle resource);
+
+    VkDevice device;
+    VkPhysicalDevice physicalDevice;
+    MemoryTracker* memoryTracker;
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<BarrierBatch> passBarriers;
+    BarrierBatch finalBarriers;
+    std::vector<VkDeviceMemory> memoryBlocks;
+    bool isCompiled = false;
+    Stats stats;
+};
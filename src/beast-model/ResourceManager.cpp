@@ -0,0 +1,192 @@
+#include "ResourceManager.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <cstdio>
+#include <stdexcept>
+#include <unordered_map>
+
+static ModelData parseModel(const std::string& path, Profiler& profiler) {
+    ProfileZone zone(profiler, "parse model");
+    const auto start = std::chrono::steady_clock::now();
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str()))
+        throw std::runtime_error(warn + err);
+
+    ModelData model;
+    std::unordered_map<Vertex, uint32_t> uniqueVertices;
+
+    for (const auto& shape : shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            Vertex vertex = {};
+
+            vertex.pos = {
+                attrib.vertices[3 * index.vertex_index + 0],
+                attrib.vertices[3 * index.vertex_index + 1],
+                attrib.vertices[3 * index.vertex_index + 2]
+            };
+
+            vertex.texCoord = {
+                attrib.texcoords[2 * index.texcoord_index + 0],
+                attrib.texcoords[2 * index.texcoord_index + 1]
+            };
+
+            vertex.color = {1.0f, 1.0f, 1.0f};
+
+            if (uniqueVertices.count(vertex) == 0) {
+                uniqueVertices[vertex] = static_cast<uint32_t>(model.vertices.size());    // value for setting at indices later
+                model.vertices.push_back(vertex);
+            }
+
+            model.indices.push_back(uniqueVertices[vertex]);
+        }
+    }
+
+    model.numSourceVertices = attrib.vertices.size();
+    model.parseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return model;
+}
+
+static TextureData decodeTexture(const std::string& path, Profiler& profiler) {
+    ProfileZone zone(profiler, "decode texture");
+    const auto start = std::chrono::steady_clock::now();
+
+    TextureData texture;
+    int texChannels;
+    texture.pixels = stbi_load(path.c_str(), &texture.width, &texture.height, &texChannels, STBI_rgb_alpha);
+
+    if (!texture.pixels)
+        throw std::runtime_error("failed to load texture image " + path + "!");
+
+    texture.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return texture;
+}
+
+ResourceManager::~ResourceManager() {
+    // make sure no loader is still writing into memory we are about to release
+    for (auto& future : meshFutures) {
+        if (future.valid())
+            future.wait();
+    }
+    for (auto& future : textureFutures) {
+        if (future.valid()) {
+            try {
+                TextureData texture = future.get();
+                stbi_image_free(texture.pixels);
+            }
+            catch (const std::exception&) {
+            }
+        }
+    }
+
+    releaseTexturePixels();
+}
+
+// assets are identified by their (resolved) path
+uint32_t ResourceManager::findOrAddPath(std::vector<std::string>& paths, const std::string& path) {
+    auto it = std::find(paths.begin(), paths.end(), path);
+    if (it != paths.end())
+        return static_cast<uint32_t>(it - paths.begin());
+
+    paths.push_back(path);
+    return static_cast<uint32_t>(paths.size() - 1);
+}
+
+void ResourceManager::beginLoad(const Scene& scene, std::launch policy, Profiler& profiler) {
+    std::unordered_map<std::string, uint32_t> meshByName;
+    std::unordered_map<std::string, uint32_t> textureByName;
+    std::unordered_map<std::string, uint32_t> materialByName;
+
+    for (const SceneMesh& mesh : scene.meshes)
+        meshByName[mesh.name] = findOrAddPath(meshPaths, mesh.path);
+    for (const SceneTexture& texture : scene.textures)
+        textureByName[texture.name] = findOrAddPath(texturePaths, texture.path);
+
+    for (const SceneMaterial& sceneMaterial : scene.materials) {
+        Material material;
+        material.texture = textureByName.at(sceneMaterial.texture);
+        material.variant.useTexture = sceneMaterial.isTextured;
+        material.variant.useVertexColor = sceneMaterial.hasVertexColor;
+        material.variant.alphaCutoff = sceneMaterial.alphaCutoff;
+        materialByName[sceneMaterial.name] = static_cast<uint32_t>(materials.size());
+        materials.push_back(material);
+    }
+
+    for (const SceneInstance& sceneInstance : scene.instances) {
+        Instance instance;
+        instance.mesh = meshByName.at(sceneInstance.mesh);
+        instance.material = materialByName.at(sceneInstance.material);
+        instance.transform = sceneInstance.transform;
+        instances.push_back(instance);
+    }
+
+    // group by material, then by mesh to minimize state changes while drawing
+    std::stable_sort(instances.begin(), instances.end(), [](const Instance& a, const Instance& b) {
+        return a.material != b.material ? a.material < b.material : a.mesh < b.mesh;
+    });
+
+    stats.meshRefs = static_cast<uint32_t>(scene.meshes.size());
+    stats.uniqueMeshes = static_cast<uint32_t>(meshPaths.size());
+    stats.textureRefs = static_cast<uint32_t>(scene.textures.size());
+    stats.uniqueTextures = static_cast<uint32_t>(texturePaths.size());
+
+    for (const std::string& path : meshPaths)
+        meshFutures.push_back(std::async(policy, parseModel, path, std::ref(profiler)));
+    for (const std::string& path : texturePaths)
+        textureFutures.push_back(std::async(policy, decodeTexture, path, std::ref(profiler)));
+}
+
+void ResourceManager::finishLoad() {
+    for (auto& future : textureFutures) {
+        textures.push_back(future.get());
+        stats.textureDecodeMs += textures.back().decodeMs;
+    }
+    textureFutures.clear();
+
+    // pack all meshes one after another, indices stay relative to their mesh (see vertexOffset)
+    for (auto& future : meshFutures) {
+        ModelData model = future.get();
+
+        Mesh mesh;
+        mesh.firstIndex = static_cast<uint32_t>(indices.size());
+        mesh.indexCount = static_cast<uint32_t>(model.indices.size());
+        mesh.vertexOffset = static_cast<int32_t>(vertices.size());
+        mesh.vertexCount = static_cast<uint32_t>(model.vertices.size());
+        meshes.push_back(mesh);
+
+        vertices.insert(vertices.end(), model.vertices.begin(), model.vertices.end());
+        indices.insert(indices.end(), model.indices.begin(), model.indices.end());
+
+        stats.numSourceVertices += model.numSourceVertices;
+        stats.modelParseMs += model.parseMs;
+    }
+    meshFutures.clear();
+}
+
+void ResourceManager::releaseTexturePixels() {
+    for (TextureData& texture : textures) {
+        if (texture.pixels != nullptr) {
+            stbi_image_free(texture.pixels);
+            texture.pixels = nullptr;
+        }
+    }
+}
+
+void ResourceManager::printStats() const {
+    std::printf("Resources: %u/%u unique mesh(es), %u/%u unique texture(s), %zu material(s), %zu instance(s)\n",
+            stats.uniqueMeshes, stats.meshRefs, stats.uniqueTextures, stats.textureRefs, materials.size(), instances.size());
+    std::printf("  megabuffers: %zu vertices (%zu KB) from %zu source vertices, %zu indices (%zu KB)\n",
+            vertices.size(), vertices.size() * sizeof(Vertex) / 1024, stats.numSourceVertices / 3, indices.size(), indices.size() * sizeof(uint32_t) / 1024);
+}
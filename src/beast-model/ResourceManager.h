@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Profiler.h"
+#include "Scene.h"
+#include "ShaderVariants.h"
+#include "Vertex.h"
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+// CPU side results of asset loading, produced on background threads
+struct ModelData {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    size_t numSourceVertices = 0;
+    double parseMs = 0.0;
+};
+
+struct TextureData {
+    unsigned char* pixels = nullptr;    // RGBA8, owned by ResourceManager
+    int width = 0;
+    int height = 0;
+    double decodeMs = 0.0;
+};
+
+/*
+ * Loads assets referenced by a scene.
+ * Meshes, and textures referenced by more than one entry (same path) are loaded once.
+ * Every unique mesh is packed into one shared vertex, and index array (megabuffers),
+ * each mesh is then addressed by its offsets for vkCmdDrawIndexed().
+ *
+ * beginLoad() kicks off parsing, and decoding on background threads (one task per unique asset),
+ * finishLoad() joins them, and packs geometry.
+ */
+class ResourceManager {
+public:
+    struct Mesh {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t vertexOffset;
+        uint32_t vertexCount;
+    };
+
+    struct Material {
+        uint32_t texture;
+        ShaderVariant variant;
+    };
+
+    struct Instance {
+        uint32_t mesh;
+        uint32_t material;
+        glm::mat4 transform;
+    };
+
+    struct Stats {
+        uint32_t meshRefs = 0;          // meshes listed in scene
+        uint32_t uniqueMeshes = 0;      // actually loaded
+        uint32_t textureRefs = 0;
+        uint32_t uniqueTextures = 0;
+        size_t numSourceVertices = 0;
+        double modelParseMs = 0.0;      // summed over loader tasks
+        double textureDecodeMs = 0.0;   // summed over loader tasks
+    };
+
+    ResourceManager() = default;
+    ~ResourceManager();
+    ResourceManager(const ResourceManager&) = delete;
+    ResourceManager& operator=(const ResourceManager&) = delete;
+
+    // loader tasks are recorded as zones of profiler, which has to outlive them
+    void beginLoad(const Scene& scene, std::launch policy, Profiler& profiler);
+    void finishLoad();
+
+    const std::vector<Vertex>& getVertices() const { return vertices; }
+    const std::vector<uint32_t>& getIndices() const { return indices; }
+    const std::vector<Mesh>& getMeshes() const { return meshes; }
+    const std::vector<TextureData>& getTextures() const { return textures; }
+    const std::vector<Material>& getMaterials() const { return materials; }
+    const std::vector<Instance>& getInstances() const { return instances; }
+
+    // pixels are no longer needed once uploaded
+    void releaseTexturePixels();
+
+    const Stats& getStats() const { return stats; }
+    void printStats() const;
+
+private:
+    uint32_t findOrAddPath(std::vector<std::string>& paths, const std::string& path);
+
+    std::vector<std::string> meshPaths;
+    std::vector<std::string> texturePaths;
+    std::vector<std::future<ModelData>> meshFutures;
+    std::vector<std::future<TextureData>> textureFutures;
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Mesh> meshes;
+    std::vector<TextureData> textures;
+    std::vector<Material> materials;
+    std::vector<Instance> instances;
+    Stats stats;
+};
@@ -0,0 +1,343 @@
+#include "Scene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+// minimal JSON value, enough for scene files (no unicode escapes)
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    const JsonValue* find(const char* key) const {
+        for (const auto& member : object) {
+            if (member.first == key)
+                return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    JsonParser(const std::string& text, const std::string& filename)
+        : text(text)
+        , filename(filename) {
+    }
+
+    JsonValue parse() {
+        JsonValue value = parseValue();
+        skipWhitespace();
+        if (pos != text.size())
+            fail("unexpected trailing characters");
+        return value;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& message) const {
+        size_t line = 1;
+        for (size_t i=0; i<pos && i<text.size(); ++i) {
+            if (text[i] == '\n')
+                ++line;
+        }
+        throw std::runtime_error("failed to parse scene file " + filename + ":" + std::to_string(line) + ": " + message);
+    }
+
+    void skipWhitespace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+            ++pos;
+    }
+
+    void expect(char c) {
+        skipWhitespace();
+        if (pos >= text.size() || text[pos] != c)
+            fail(std::string("expected '") + c + "'");
+        ++pos;
+    }
+
+    bool consume(char c) {
+        skipWhitespace();
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool consumeKeyword(const char* keyword) {
+        const std::string word(keyword);
+        if (text.compare(pos, word.size(), word) != 0)
+            return false;
+        pos += word.size();
+        return true;
+    }
+
+    JsonValue parseValue() {
+        skipWhitespace();
+        if (pos >= text.size())
+            fail("unexpected end of file");
+
+        JsonValue value;
+        const char c = text[pos];
+        if (c == '{') {
+            value.type = JsonValue::Type::Object;
+            ++pos;
+            if (consume('}'))
+                return value;
+            do {
+                skipWhitespace();
+                std::string key = parseString();
+                expect(':');
+                value.object.push_back(std::make_pair(key, parseValue()));
+            } while (consume(','));
+            expect('}');
+        }
+        else if (c == '[') {
+            value.type = JsonValue::Type::Array;
+            ++pos;
+            if (consume(']'))
+                return value;
+            do {
+                value.array.push_back(parseValue());
+            } while (consume(','));
+            expect(']');
+        }
+        else if (c == '"') {
+            value.type = JsonValue::Type::String;
+            value.string = parseString();
+        }
+        else if (consumeKeyword("true")) {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+        }
+        else if (consumeKeyword("false")) {
+            value.type = JsonValue::Type::Bool;
+        }
+        else if (consumeKeyword("null")) {
+            value.type = JsonValue::Type::Null;
+        }
+        else {
+            const char* begin = text.c_str() + pos;
+            char* end = nullptr;
+            value.type = JsonValue::Type::Number;
+            value.number = std::strtod(begin, &end);
+            if (end == begin)
+                fail("unexpected character");
+            pos += static_cast<size_t>(end - begin);
+        }
+        return value;
+    }
+
+    std::string parseString() {
+        if (pos >= text.size() || text[pos] != '"')
+            fail("expected string");
+        ++pos;
+
+        std::string result;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c == '\\') {
+                if (pos >= text.size())
+                    break;
+                c = text[pos++];
+                switch (c) {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case 'r': c = '\r'; break;
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case '"': case '\\': case '/': break;
+                    default: fail("unsupported escape sequence");
+                }
+            }
+            result.push_back(c);
+        }
+        if (pos >= text.size())
+            fail("unterminated string");
+        ++pos;
+        return result;
+    }
+
+    const std::string& text;
+    const std::string& filename;
+    size_t pos = 0;
+};
+
+static std::string getDirectory(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+static bool isAbsolutePath(const std::string& path) {
+    return !path.empty() && (path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':'));
+}
+
+static std::string getString(const JsonValue& object, const char* key, const std::string& context) {
+    const JsonValue* value = object.find(key);
+    if (value == nullptr || value->type != JsonValue::Type::String)
+        throw std::runtime_error("scene: " + context + " requires string \"" + key + "\"");
+    return value->string;
+}
+
+static glm::vec3 getVec3(const JsonValue& object, const char* key, const glm::vec3& defaultValue, const std::string& context) {
+    const JsonValue* value = object.find(key);
+    if (value == nullptr)
+        return defaultValue;
+    // single number is a uniform value (e.g. scale)
+    if (value->type == JsonValue::Type::Number)
+        return glm::vec3(static_cast<float>(value->number));
+    if (value->type != JsonValue::Type::Array || value->array.size() != 3)
+        throw std::runtime_error("scene: " + context + " \"" + key + "\" has to be an array of 3 numbers");
+
+    glm::vec3 result;
+    for (int i=0; i<3; ++i) {
+        if (value->array[i].type != JsonValue::Type::Number)
+            throw std::runtime_error("scene: " + context + " \"" + key + "\" has to be an array of 3 numbers");
+        result[i] = static_cast<float>(value->array[i].number);
+    }
+    return result;
+}
+
+static bool getBool(const JsonValue& object, const char* key, bool defaultValue, const std::string& context) {
+    const JsonValue* value = object.find(key);
+    if (value == nullptr)
+        return defaultValue;
+    if (value->type != JsonValue::Type::Bool)
+        throw std::runtime_error("scene: " + context + " \"" + key + "\" has to be true or false");
+    return value->boolean;
+}
+
+static float getNumber(const JsonValue& object, const char* key, float defaultValue, const std::string& context) {
+    const JsonValue* value = object.find(key);
+    if (value == nullptr)
+        return defaultValue;
+    if (value->type != JsonValue::Type::Number)
+        throw std::runtime_error("scene: " + context + " \"" + key + "\" has to be a number");
+    return static_cast<float>(value->number);
+}
+
+static const std::vector<JsonValue>& getArray(const JsonValue& root, const char* key) {
+    static const std::vector<JsonValue> empty;
+    const JsonValue* value = root.find(key);
+    if (value == nullptr)
+        return empty;
+    if (value->type != JsonValue::Type::Array)
+        throw std::runtime_error(std::string("scene: \"") + key + "\" has to be an array");
+    return value->array;
+}
+
+Scene Scene::loadFromFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open scene file " + path + "!");
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    const std::string text = stream.str();
+
+    JsonValue root = JsonParser(text, path).parse();
+    if (root.type != JsonValue::Type::Object)
+        throw std::runtime_error("scene: root of " + path + " has to be an object");
+
+    const std::string directory = getDirectory(path);
+    auto resolvePath = [&](const std::string& assetPath) {
+        return isAbsolutePath(assetPath) ? assetPath : directory + assetPath;
+    };
+
+    Scene scene;
+    std::set<std::string> meshNames;
+    std::set<std::string> textureNames;
+    std::set<std::string> materialNames;
+
+    for (const JsonValue& entry : getArray(root, "meshes")) {
+        SceneMesh mesh;
+        mesh.name = getString(entry, "name", "mesh");
+        mesh.path = resolvePath(getString(entry, "path", "mesh " + mesh.name));
+        if (!meshNames.insert(mesh.name).second)
+            throw std::runtime_error("scene: duplicate mesh name " + mesh.name);
+        scene.meshes.push_back(mesh);
+    }
+
+    for (const JsonValue& entry : getArray(root, "textures")) {
+        SceneTexture texture;
+        texture.name = getString(entry, "name", "texture");
+        texture.path = resolvePath(getString(entry, "path", "texture " + texture.name));
+        if (!textureNames.insert(texture.name).second)
+            throw std::runtime_error("scene: duplicate texture name " + texture.name);
+        scene.textures.push_back(texture);
+    }
+
+    for (const JsonValue& entry : getArray(root, "materials")) {
+        SceneMaterial material;
+        material.name = getString(entry, "name", "material");
+        material.texture = getString(entry, "texture", "material " + material.name);
+        if (textureNames.count(material.texture) == 0)
+            throw std::runtime_error("scene: material " + material.name + " refers to unknown texture " + material.texture);
+        material.isTextured = getBool(entry, "textured", true, "material " + material.name);
+        material.hasVertexColor = getBool(entry, "vertexColor", false, "material " + material.name);
+        material.alphaCutoff = getNumber(entry, "alphaCutoff", 0.0f, "material " + material.name);
+        if (material.alphaCutoff < 0.0f || material.alphaCutoff > 1.0f)
+            throw std::runtime_error("scene: material " + material.name + " \"alphaCutoff\" has to be within [0, 1]");
+        if (!materialNames.insert(material.name).second)
+            throw std::runtime_error("scene: duplicate material name " + material.name);
+        scene.materials.push_back(material);
+    }
+
+    for (const JsonValue& entry : getArray(root, "instances")) {
+        SceneInstance instance;
+        instance.mesh = getString(entry, "mesh", "instance");
+        instance.material = getString(entry, "material", "instance of " + instance.mesh);
+        if (meshNames.count(instance.mesh) == 0)
+            throw std::runtime_error("scene: instance refers to unknown mesh " + instance.mesh);
+        if (materialNames.count(instance.material) == 0)
+            throw std::runtime_error("scene: instance refers to unknown material " + instance.material);
+
+        const std::string context = "instance of " + instance.mesh;
+        const glm::vec3 translation = getVec3(entry, "translation", glm::vec3(0.0f), context);
+        const glm::vec3 rotation = getVec3(entry, "rotation", glm::vec3(0.0f), context);
+        const glm::vec3 scale = getVec3(entry, "scale", glm::vec3(1.0f), context);
+
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), translation);
+        transform = glm::rotate(transform, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+        transform = glm::rotate(transform, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+        transform = glm::rotate(transform, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+        instance.transform = glm::scale(transform, scale);
+        scene.instances.push_back(instance);
+    }
+
+    const JsonValue* depthPrepass = root.find("depthPrepass");
+    if (depthPrepass != nullptr) {
+        if (depthPrepass->type != JsonValue::Type::Bool)
+            throw std::runtime_error("scene: \"depthPrepass\" has to be true or false");
+        scene.depthPrepass = depthPrepass->boolean;
+    }
+
+    if (scene.instances.empty())
+        throw std::runtime_error("scene: " + path + " has no instances");
+
+    return scene;
+}
+
+Scene Scene::makeSingleModel(const std::string& modelPath, const std::string& texturePath) {
+    Scene scene;
+    scene.meshes.push_back({ "model", modelPath });
+    scene.textures.push_back({ "texture", texturePath });
+    SceneMaterial material;
+    material.name = "material";
+    material.texture = "texture";
+    scene.materials.push_back(material);
+    scene.instances.push_back({ "model", "material", glm::mat4(1.0f) });
+    return scene;
+}
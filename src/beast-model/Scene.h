@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#ifndef GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#endif
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/*
+ * Scene description, lists meshes, textures, materials and instances referring to them by name.
+ *
+ * File format (JSON), relative paths are resolved against directory of the scene file
+ * {
+ *   "meshes":    [ { "name": "beast", "path": "beast.obj" } ],
+ *   "textures":  [ { "name": "beast", "path": "beast.png" } ],
+ *   "materials": [ { "name": "beast", "texture": "beast", "textured": true, "vertexColor": false, "alphaCutoff": 0.5 } ],
+ *   "instances": [ { "mesh": "beast", "material": "beast",
+ *                    "translation": [0, 0, 0], "rotation": [0, 0, 90], "scale": 1.0 } ],
+ *   "depthPrepass": true
+ * }
+ * rotation is in degrees around x, y then z axis, scale is either a number or [x, y, z].
+ * depthPrepass is optional (default false), worth it for scenes with a lot of overdraw.
+ * Material's textured (default true), vertexColor (default false), and alphaCutoff (default 0, no alpha test)
+ * are optional, they select a shader variant, texture is bound even if not sampled.
+ */
+struct SceneMesh {
+    std::string name;
+    std::string path;
+};
+
+struct SceneTexture {
+    std::string name;
+    std::string path;
+};
+
+struct SceneMaterial {
+    std::string name;
+    std::string texture;
+    bool isTextured = true;
+    bool hasVertexColor = false;
+    float alphaCutoff = 0.0f;
+};
+
+struct SceneInstance {
+    std::string mesh;
+    std::string material;
+    glm::mat4 transform;
+};
+
+struct Scene {
+    std::vector<SceneMesh> meshes;
+    std::vector<SceneTexture> textures;
+    std::vector<SceneMaterial> materials;
+    std::vector<SceneInstance> instances;
+    bool depthPrepass = false;      // lay down depth first, then shade only visible fragments
+
+    // throws std::runtime_error on malformed file, or references to unknown names
+    static Scene loadFromFile(const std::string& path);
+    // single instance of one model with one texture
+    static Scene makeSingleModel(const std::string& modelPath, const std::string& texturePath);
+};
@@ -0,0 +1,51 @@
+#include "ShaderLibrary.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// generated by shaders/compile.sh, uint32_t keeps words aligned as vkCreateShaderModule requires
+constexpr uint32_t VERT_SPV[] = {
+#include "shaders/vert.spv.inc"
+};
+constexpr uint32_t FRAG_SPV[] = {
+#include "shaders/frag.spv.inc"
+};
+constexpr uint32_t SKIN_SPV[] = {
+#include "shaders/skin.spv.inc"
+};
+
+struct EmbeddedModule {
+    const char* name;
+    const uint32_t* words;
+    size_t size;
+};
+
+const EmbeddedModule EMBEDDED_MODULES[] = {
+    { "vert.spv", VERT_SPV, sizeof(VERT_SPV) },
+    { "frag.spv", FRAG_SPV, sizeof(FRAG_SPV) },
+    { "skin.spv", SKIN_SPV, sizeof(SKIN_SPV) }
+};
+
+std::vector<char> ShaderLibrary::load(const std::string& name) const {
+    if (!overrideDirectory.empty()) {
+        std::ifstream file(overrideDirectory + "/" + name, std::ios::ate | std::ios::binary);
+        if (file.is_open()) {
+            std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(buffer.data(), buffer.size());
+            return buffer;
+        }
+    }
+
+    for (const EmbeddedModule& module : EMBEDDED_MODULES) {
+        if (name == module.name) {
+            std::vector<char> buffer(module.size);
+            std::memcpy(buffer.data(), module.words, module.size);
+            return buffer;
+        }
+    }
+    throw std::runtime_error("failed to find shader " + name + "!");
+}
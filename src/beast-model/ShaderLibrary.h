@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/*
+ * SPIR-V of shaders/ compiled into the binary. shaders/compile.sh emits each module as comma
+ * separated words as well (glslc -mfmt=num), which are included into constexpr uint32_t arrays,
+ * so loading a shader does no file I/O, and works from any working directory.
+ *
+ * With an override directory, a module of the same name there (e.g. written by compile.sh, or
+ * hot reload) takes precedence over the embedded one, for iterating without a rebuild.
+ */
+class ShaderLibrary {
+public:
+    void setOverrideDirectory(const std::string& directory) { overrideDirectory = directory; }
+    const std::string& getOverrideDirectory() const { return overrideDirectory; }
+
+    // by module name as written by compile.sh (vert.spv, frag.spv, skin.spv)
+    std::vector<char> load(const std::string& name) const;
+
+private:
+    std::string overrideDirectory;
+};
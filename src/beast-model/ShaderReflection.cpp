@@ -0,0 +1,387 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+// subset of SPIR-V enumerants (see SPIR-V specification, section 3)
+const uint32_t SPIRV_MAGIC = 0x07230203;
+const uint32_t SPIRV_HEADER_WORDS = 5;
+
+enum SpirvOp : uint32_t {
+    OP_ENTRY_POINT = 15,
+    OP_TYPE_INT = 21,
+    OP_TYPE_FLOAT = 22,
+    OP_TYPE_VECTOR = 23,
+    OP_TYPE_MATRIX = 24,
+    OP_TYPE_IMAGE = 25,
+    OP_TYPE_SAMPLER = 26,
+    OP_TYPE_SAMPLED_IMAGE = 27,
+    OP_TYPE_ARRAY = 28,
+    OP_TYPE_RUNTIME_ARRAY = 29,
+    OP_TYPE_STRUCT = 30,
+    OP_TYPE_POINTER = 32,
+    OP_CONSTANT = 43,
+    OP_VARIABLE = 59,
+    OP_DECORATE = 71,
+    OP_MEMBER_DECORATE = 72
+};
+
+enum SpirvDecoration : uint32_t {
+    DECORATION_BLOCK = 2,
+    DECORATION_BUFFER_BLOCK = 3,
+    DECORATION_ARRAY_STRIDE = 6,
+    DECORATION_MATRIX_STRIDE = 7,
+    DECORATION_BUILT_IN = 11,
+    DECORATION_LOCATION = 30,
+    DECORATION_BINDING = 33,
+    DECORATION_DESCRIPTOR_SET = 34,
+    DECORATION_OFFSET = 35
+};
+
+enum SpirvStorageClass : uint32_t {
+    STORAGE_UNIFORM_CONSTANT = 0,
+    STORAGE_INPUT = 1,
+    STORAGE_UNIFORM = 2,
+    STORAGE_PUSH_CONSTANT = 9,
+    STORAGE_STORAGE_BUFFER = 12
+};
+
+const uint32_t DIM_BUFFER = 5;
+const uint32_t DIM_SUBPASS_DATA = 6;
+
+// ids of one module, instruction operands are kept as they are
+struct SpirvModule {
+    std::unordered_map<uint32_t, std::vector<uint32_t>> types;      // result id -> opcode, followed by operands after result id
+    std::unordered_map<uint32_t, uint32_t> constants;               // first word of scalar constants
+    std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>> decorations;
+    std::map<std::pair<uint32_t, uint32_t>, std::unordered_map<uint32_t, uint32_t>> memberDecorations;
+    std::vector<std::pair<uint32_t, uint32_t>> variables;          // result type (pointer), result id
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+
+    const std::vector<uint32_t>& getType(uint32_t id) const {
+        auto it = types.find(id);
+        if (it == types.end())
+            throw std::runtime_error("failed to reflect shader, unknown type id " + std::to_string(id) + "!");
+        return it->second;
+    }
+
+    bool findDecoration(uint32_t id, uint32_t decoration, uint32_t& value) const {
+        auto it = decorations.find(id);
+        if (it == decorations.end() || it->second.count(decoration) == 0)
+            return false;
+        value = it->second.at(decoration);
+        return true;
+    }
+
+    bool hasDecoration(uint32_t id, uint32_t decoration) const {
+        uint32_t value;
+        return findDecoration(id, decoration, value);
+    }
+
+    bool findMemberDecoration(uint32_t id, uint32_t member, uint32_t decoration, uint32_t& value) const {
+        auto it = memberDecorations.find({id, member});
+        if (it == memberDecorations.end() || it->second.count(decoration) == 0)
+            return false;
+        value = it->second.at(decoration);
+        return true;
+    }
+
+    uint32_t getArrayLength(const std::vector<uint32_t>& type) const {
+        auto it = constants.find(type[2]);
+        return it == constants.end() ? 1 : it->second;
+    }
+
+    // byte size by explicit layout decorations, matrixStride applies to a matrix member of a struct
+    uint32_t getSize(uint32_t id, uint32_t matrixStride = 0) const {
+        const std::vector<uint32_t>& type = getType(id);
+        switch (type[0]) {
+        case OP_TYPE_INT:
+        case OP_TYPE_FLOAT:
+            return type[1] / 8;
+        case OP_TYPE_VECTOR:
+            return type[2] * getSize(type[1]);
+        case OP_TYPE_MATRIX:
+            return type[2] * (matrixStride > 0 ? matrixStride : getSize(type[1]));
+        case OP_TYPE_ARRAY: {
+            uint32_t stride;
+            if (!findDecoration(id, DECORATION_ARRAY_STRIDE, stride))
+                stride = getSize(type[1], matrixStride);
+            return getArrayLength(type) * stride;
+        }
+        case OP_TYPE_RUNTIME_ARRAY:
+            return 0;
+        case OP_TYPE_STRUCT: {
+            uint32_t size = 0;
+            for (uint32_t member=0; member+1<type.size(); ++member) {
+                uint32_t offset = 0;
+                uint32_t memberMatrixStride = 0;
+                findMemberDecoration(id, member, DECORATION_OFFSET, offset);
+                findMemberDecoration(id, member, DECORATION_MATRIX_STRIDE, memberMatrixStride);
+                size = std::max(size, offset + getSize(type[member + 1], memberMatrixStride));
+            }
+            return size;
+        }
+        default:
+            throw std::runtime_error("failed to reflect shader, unsupported type in block!");
+        }
+    }
+};
+
+static VkShaderStageFlagBits getStage(uint32_t executionModel) {
+    switch (executionModel) {
+    case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+    default:
+        throw std::runtime_error("failed to reflect shader, unsupported execution model!");
+    }
+}
+
+static VkFormat getVertexFormat(const SpirvModule& module, uint32_t typeId) {
+    const std::vector<uint32_t>* type = &module.getType(typeId);
+    uint32_t components = 1;
+    if ((*type)[0] == OP_TYPE_VECTOR) {
+        components = (*type)[2];
+        type = &module.getType((*type)[1]);
+    }
+
+    static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+    static const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+    static const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+    if (components < 1 || components > 4 || (*type)[1] != 32)
+        throw std::runtime_error("failed to reflect shader, unsupported vertex input type!");
+
+    if ((*type)[0] == OP_TYPE_FLOAT)
+        return floatFormats[components - 1];
+    if ((*type)[0] == OP_TYPE_INT)
+        return (*type)[2] ? intFormats[components - 1] : uintFormats[components - 1];
+    throw std::runtime_error("failed to reflect shader, unsupported vertex input type!");
+}
+
+static SpirvModule parseModule(const std::vector<char>& code) {
+    if (code.size() % sizeof(uint32_t) != 0 || code.size() < SPIRV_HEADER_WORDS * sizeof(uint32_t))
+        throw std::runtime_error("failed to reflect shader, not a SPIR-V module!");
+    std::vector<uint32_t> words(code.size() / sizeof(uint32_t));
+    std::memcpy(words.data(), code.data(), code.size());
+    if (words[0] != SPIRV_MAGIC)
+        throw std::runtime_error("failed to reflect shader, not a SPIR-V module!");
+
+    SpirvModule module;
+    bool hasEntryPoint = false;
+    for (size_t i=SPIRV_HEADER_WORDS; i<words.size();) {
+        const uint32_t wordCount = words[i] >> 16;
+        const uint32_t opcode = words[i] & 0xffff;
+        if (wordCount == 0 || i + wordCount > words.size())
+            throw std::runtime_error("failed to reflect shader, truncated instruction!");
+        const uint32_t* operands = &words[i + 1];
+        const uint32_t numOperands = wordCount - 1;
+
+        switch (opcode) {
+        case OP_ENTRY_POINT:
+            // modules here have a single entry point
+            if (!hasEntryPoint)
+                module.stage = getStage(operands[0]);
+            hasEntryPoint = true;
+            break;
+        case OP_TYPE_INT:
+        case OP_TYPE_FLOAT:
+        case OP_TYPE_VECTOR:
+        case OP_TYPE_MATRIX:
+        case OP_TYPE_IMAGE:
+        case OP_TYPE_SAMPLER:
+        case OP_TYPE_SAMPLED_IMAGE:
+        case OP_TYPE_ARRAY:
+        case OP_TYPE_RUNTIME_ARRAY:
+        case OP_TYPE_STRUCT:
+        case OP_TYPE_POINTER: {
+            std::vector<uint32_t> type(1, opcode);
+            type.insert(type.end(), operands + 1, operands + numOperands);
+            module.types[operands[0]] = type;
+            break;
+        }
+        case OP_CONSTANT:
+            if (numOperands >= 3)
+                module.constants[operands[1]] = operands[2];
+            break;
+        case OP_VARIABLE:
+            module.variables.emplace_back(operands[0], operands[1]);
+            break;
+        case OP_DECORATE:
+            module.decorations[operands[0]][operands[1]] = numOperands >= 3 ? operands[2] : 0;
+            break;
+        case OP_MEMBER_DECORATE:
+            module.memberDecorations[{operands[0], operands[1]}][operands[2]] = numOperands >= 4 ? operands[3] : 0;
+            break;
+        default:
+            break;
+        }
+        i += wordCount;
+    }
+
+    if (!hasEntryPoint)
+        throw std::runtime_error("failed to reflect shader, module has no entry point!");
+    return module;
+}
+
+void ShaderReflection::addModule(const std::vector<char>& code) {
+    const SpirvModule module = parseModule(code);
+    std::vector<VkVertexInputAttributeDescription> attributes;
+
+    for (const auto& variable : module.variables) {
+        const std::vector<uint32_t>& pointer = module.getType(variable.first);
+        const uint32_t storageClass = pointer[1];
+        const uint32_t id = variable.second;
+        uint32_t typeId = pointer[2];
+
+        if (storageClass == STORAGE_INPUT) {
+            uint32_t location;
+            if (module.stage != VK_SHADER_STAGE_VERTEX_BIT || module.hasDecoration(id, DECORATION_BUILT_IN) || !module.findDecoration(id, DECORATION_LOCATION, location))
+                continue;
+            VkVertexInputAttributeDescription attribute = {};
+            attribute.location = location;
+            attribute.format = getVertexFormat(module, typeId);
+            attributes.push_back(attribute);
+            continue;
+        }
+
+        if (storageClass == STORAGE_PUSH_CONSTANT) {
+            pushConstantStages |= module.stage;
+            pushConstantSize = std::max(pushConstantSize, module.getSize(typeId));
+            continue;
+        }
+
+        if (storageClass != STORAGE_UNIFORM_CONSTANT && storageClass != STORAGE_UNIFORM && storageClass != STORAGE_STORAGE_BUFFER)
+            continue;
+
+        uint32_t set = 0;
+        uint32_t binding = 0;
+        module.findDecoration(id, DECORATION_DESCRIPTOR_SET, set);
+        if (!module.findDecoration(id, DECORATION_BINDING, binding))
+            continue;
+
+        // arrays of resources take one binding with descriptorCount elements
+        uint32_t count = 1;
+        const std::vector<uint32_t>* type = &module.getType(typeId);
+        if ((*type)[0] == OP_TYPE_ARRAY || (*type)[0] == OP_TYPE_RUNTIME_ARRAY) {
+            count = (*type)[0] == OP_TYPE_ARRAY ? module.getArrayLength(*type) : 1;
+            typeId = (*type)[1];
+            type = &module.getType(typeId);
+        }
+
+        VkDescriptorType descriptorType;
+        VkDeviceSize bufferSize = 0;
+        if (storageClass == STORAGE_UNIFORM || storageClass == STORAGE_STORAGE_BUFFER) {
+            const bool isStorage = storageClass == STORAGE_STORAGE_BUFFER || module.hasDecoration(typeId, DECORATION_BUFFER_BLOCK);
+            descriptorType = isStorage ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            bufferSize = module.getSize(typeId);
+        }
+        else if ((*type)[0] == OP_TYPE_SAMPLED_IMAGE)
+            descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        else if ((*type)[0] == OP_TYPE_SAMPLER)
+            descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        else if ((*type)[0] == OP_TYPE_IMAGE) {
+            // operands: sampled type, dim, depth, arrayed, ms, sampled (1 with sampler, 2 storage)
+            const uint32_t dim = (*type)[2];
+            const bool isStorage = (*type)[6] == 2;
+            if (dim == DIM_SUBPASS_DATA)
+                descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            else if (dim == DIM_BUFFER)
+                descriptorType = isStorage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            else
+                descriptorType = isStorage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+        else
+            continue;
+
+        auto it = resources.find({set, binding});
+        if (it != resources.end()) {
+            VkDescriptorSetLayoutBinding& existing = it->second.layoutBinding;
+            if (existing.descriptorType != descriptorType || existing.descriptorCount != count)
+                throw std::runtime_error("failed to reflect shader, set " + std::to_string(set) + " binding " + std::to_string(binding) + " differs between stages!");
+            existing.stageFlags |= module.stage;
+            it->second.bufferSize = std::max(it->second.bufferSize, bufferSize);
+            continue;
+        }
+
+        Resource resource = {};
+        resource.layoutBinding.binding = binding;
+        resource.layoutBinding.descriptorType = descriptorType;
+        resource.layoutBinding.descriptorCount = count;
+        resource.layoutBinding.stageFlags = module.stage;
+        resource.layoutBinding.pImmutableSamplers = nullptr;
+        resource.bufferSize = bufferSize;
+        resources[{set, binding}] = resource;
+    }
+
+    if (module.stage != VK_SHADER_STAGE_VERTEX_BIT)
+        return;
+
+    std::sort(attributes.begin(), attributes.end(), [](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b) {
+        return a.location < b.location;
+    });
+    vertexAttributes = attributes;
+}
+
+uint32_t ShaderReflection::getNumSets() const {
+    return resources.empty() ? 0 : resources.rbegin()->first.first + 1;
+}
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::getSetBindings(uint32_t set) const {
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    for (const auto& entry : resources) {
+        if (entry.first.first == set)
+            bindings.push_back(entry.second.layoutBinding);
+    }
+    return bindings;
+}
+
+VkDeviceSize ShaderReflection::getBufferSize(uint32_t set, uint32_t binding) const {
+    auto it = resources.find({set, binding});
+    return it == resources.end() ? 0 : it->second.bufferSize;
+}
+
+std::vector<VkPushConstantRange> ShaderReflection::getPushConstantRanges() const {
+    std::vector<VkPushConstantRange> ranges;
+    if (pushConstantStages != 0)
+        ranges.push_back({pushConstantStages, 0, pushConstantSize});
+    return ranges;
+}
+
+bool ShaderReflection::isLayoutCompatible(const ShaderReflection& other) const {
+    if (resources.size() != other.resources.size() || pushConstantStages != other.pushConstantStages || pushConstantSize != other.pushConstantSize ||
+        vertexAttributes.size() != other.vertexAttributes.size())
+        return false;
+
+    for (auto it = resources.begin(), otherIt = other.resources.begin(); it != resources.end(); ++it, ++otherIt) {
+        const VkDescriptorSetLayoutBinding& a = it->second.layoutBinding;
+        const VkDescriptorSetLayoutBinding& b = otherIt->second.layoutBinding;
+        // buffers are created, and written at their reflected size, so it can't change either
+        if (it->first != otherIt->first || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags ||
+            it->second.bufferSize != otherIt->second.bufferSize)
+            return false;
+    }
+    for (size_t i=0; i<vertexAttributes.size(); ++i) {
+        if (vertexAttributes[i].location != other.vertexAttributes[i].location || vertexAttributes[i].format != other.vertexAttributes[i].format)
+            return false;
+    }
+    return true;
+}
+
+void ShaderReflection::addPoolSizes(uint32_t set, float setShare, DescriptorAllocator::PoolSizes& poolSizes) const {
+    for (const VkDescriptorSetLayoutBinding& binding : getSetBindings(set)) {
+        const float count = static_cast<float>(binding.descriptorCount) * setShare;
+        auto it = std::find_if(poolSizes.sizes.begin(), poolSizes.sizes.end(), [&](const std::pair<VkDescriptorType, float>& size) {
+            return size.first == binding.descriptorType;
+        });
+        if (it != poolSizes.sizes.end())
+            it->second += count;
+        else
+            poolSizes.sizes.emplace_back(binding.descriptorType, count);
+    }
+}
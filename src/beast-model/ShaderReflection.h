@@ -0,0 +1,56 @@
+#pragma once
+
+#include "DescriptorAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+/*
+ * Minimal SPIR-V reflection, enough to derive layouts from the shaders instead of mirroring
+ * GLSL declarations by hand.
+ *
+ * Each added module contributes its descriptor bindings (merged across stages, same set/binding
+ * has to have the same type, and count), its push constant block, and for vertex shaders the
+ * input attributes' locations, and formats. Offsets aren't reflected, they come from the vertex
+ * struct the attributes are read from.
+ *
+ * Specialization constants used as array sizes are not resolved, such arrays count as one.
+ */
+class ShaderReflection {
+public:
+    // throws std::runtime_error on malformed SPIR-V, or bindings conflicting with other stages
+    void addModule(const std::vector<char>& code);
+
+    uint32_t getNumSets() const;
+    // sorted by binding index, empty for sets not used by any stage
+    std::vector<VkDescriptorSetLayoutBinding> getSetBindings(uint32_t set) const;
+    // size of uniform, or storage block without its runtime array, 0 if binding isn't a buffer
+    VkDeviceSize getBufferSize(uint32_t set, uint32_t binding) const;
+
+    // single range over all stages using push constants, empty if none does
+    std::vector<VkPushConstantRange> getPushConstantRanges() const;
+
+    // location, and format of vertex shader inputs sorted by location, binding, and offset are left 0
+    const std::vector<VkVertexInputAttributeDescription>& getVertexInputs() const { return vertexAttributes; }
+
+    // same descriptor bindings and buffer sizes, push constants, and vertex inputs, i.e. layouts built from either are interchangeable
+    bool isLayoutCompatible(const ShaderReflection& other) const;
+
+    // add descriptors of a set, scaled by its share of all sets to be allocated, to pool multipliers
+    void addPoolSizes(uint32_t set, float setShare, DescriptorAllocator::PoolSizes& poolSizes) const;
+
+private:
+    struct Resource {
+        VkDescriptorSetLayoutBinding layoutBinding;
+        VkDeviceSize bufferSize;
+    };
+
+    std::map<std::pair<uint32_t, uint32_t>, Resource> resources;    // by set, and binding
+    VkShaderStageFlags pushConstantStages = 0;
+    uint32_t pushConstantSize = 0;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+};
@@ -0,0 +1,190 @@
+#include "ShaderVariants.h"
+#include "PipelineCompiler.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+// layout of constants as consumed by main.frag, bools are 32-bit in SPIR-V
+struct SpecializationData {
+    VkBool32 useTexture;
+    VkBool32 useVertexColor;
+    VkBool32 alphaTest;
+    float alphaCutoff;
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint64_t ShaderVariant::getKey() const {
+    uint32_t cutoffBits = 0;
+    if (isAlphaTested())
+        std::memcpy(&cutoffBits, &alphaCutoff, sizeof(cutoffBits));
+
+    uint64_t key = static_cast<uint64_t>(cutoffBits) << 32;
+    key |= useTexture ? 1u : 0u;
+    key |= useVertexColor ? 2u : 0u;
+    return key;
+}
+
+void ShaderVariantCache::init(VkDevice device, Creator creator, PipelineCompiler* compiler) {
+    this->device = device;
+    this->creator = creator;
+    this->compiler = compiler != nullptr && compiler->getNumThreads() > 0 ? compiler : nullptr;
+}
+
+void ShaderVariantCache::cleanup() {
+    clear();
+    creator = nullptr;
+    compiler = nullptr;
+}
+
+void ShaderVariantCache::setFallback(const ShaderVariant& variant) {
+    fallbackVariant = variant;
+    fallbackKey = variant.getKey();
+    hasFallback = true;
+    if (variants.count(fallbackKey) == 0) {
+        auto start = std::chrono::steady_clock::now();
+        variants.emplace(fallbackKey, create(creator, variant));
+        stallMs += elapsedMs(start);
+    }
+}
+
+void ShaderVariantCache::replaceCreator(Creator newCreator) {
+    const bool isFallbackKept = hasFallback;
+    Pipelines fallback;
+    if (isFallbackKept) {
+        auto start = std::chrono::steady_clock::now();
+        fallback = create(newCreator, fallbackVariant);
+        stallMs += elapsedMs(start);
+    }
+
+    clear();
+    creator = newCreator;
+    if (isFallbackKept) {
+        variants.emplace(fallbackKey, fallback);
+        hasFallback = true;
+    }
+}
+
+void ShaderVariantCache::prepare(const ShaderVariant& variant) {
+    const uint64_t key = variant.getKey();
+    if (compiler == nullptr || variants.count(key) != 0 || !compiling.insert(key).second)
+        return;
+
+    compiler->submit([this, key, variant]() {
+        auto start = std::chrono::steady_clock::now();
+        Pipelines pipelines;
+        std::exception_ptr error;
+        try {
+            pipelines = create(creator, variant);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(compiledMutex);
+        compileMs += elapsedMs(start);
+        if (error)
+            compileError = error;
+        else
+            compiled.emplace_back(key, pipelines);
+    });
+}
+
+const ShaderVariantCache::Pipelines& ShaderVariantCache::get(const ShaderVariant& variant) {
+    const uint64_t key = variant.getKey();
+    auto it = variants.find(key);
+    if (it != variants.end())
+        return it->second;
+
+    if (compiler != nullptr && hasFallback) {
+        prepare(variant);
+        return variants.at(fallbackKey);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Pipelines pipelines = create(creator, variant);
+    stallMs += elapsedMs(start);
+    return variants.emplace(key, pipelines).first->second;
+}
+
+bool ShaderVariantCache::collectCompiled() {
+    if (compiling.empty())
+        return false;
+
+    std::vector<std::pair<uint64_t, Pipelines>> results;
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(compiledMutex);
+        results.swap(compiled);
+        std::swap(error, compileError);
+    }
+
+    for (const auto& result : results) {
+        compiling.erase(result.first);
+        variants.emplace(result.first, result.second);
+    }
+    // failed variant is left as compiling, so it isn't queued again on every get()
+    if (error)
+        std::rethrow_exception(error);
+    return !results.empty();
+}
+
+void ShaderVariantCache::clear() {
+    // in-flight jobs use whatever pipelines are built against, so they have to finish first
+    if (compiler != nullptr && !compiling.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        compiler->waitIdle();
+        stallMs += elapsedMs(start);
+
+        std::lock_guard<std::mutex> lock(compiledMutex);
+        for (const auto& result : compiled)
+            destroy(result.second);
+        compiled.clear();
+        compileError = nullptr;
+    }
+    compiling.clear();
+
+    for (const auto& entry : variants)
+        destroy(entry.second);
+    variants.clear();
+    hasFallback = false;
+}
+
+double ShaderVariantCache::getCompileMs() const {
+    std::lock_guard<std::mutex> lock(compiledMutex);
+    return compileMs;
+}
+
+ShaderVariantCache::Pipelines ShaderVariantCache::create(const Creator& variantCreator, const ShaderVariant& variant) {
+    SpecializationData data = {};
+    data.useTexture = variant.useTexture ? VK_TRUE : VK_FALSE;
+    data.useVertexColor = variant.useVertexColor ? VK_TRUE : VK_FALSE;
+    data.alphaTest = variant.isAlphaTested() ? VK_TRUE : VK_FALSE;
+    data.alphaCutoff = variant.alphaCutoff;
+
+    std::array<VkSpecializationMapEntry, 4> mapEntries = {};
+    mapEntries[0] = {0, offsetof(SpecializationData, useTexture), sizeof(VkBool32)};
+    mapEntries[1] = {1, offsetof(SpecializationData, useVertexColor), sizeof(VkBool32)};
+    mapEntries[2] = {2, offsetof(SpecializationData, alphaTest), sizeof(VkBool32)};
+    mapEntries[3] = {3, offsetof(SpecializationData, alphaCutoff), sizeof(float)};
+
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+    specializationInfo.pMapEntries = mapEntries.data();
+    specializationInfo.dataSize = sizeof(data);
+    specializationInfo.pData = &data;
+
+    Pipelines pipelines = variantCreator(variant, specializationInfo);
+    ++numCreated;
+    return pipelines;
+}
+
+void ShaderVariantCache::destroy(const Pipelines& pipelines) {
+    vkDestroyPipeline(device, pipelines.shade, nullptr);
+    vkDestroyPipeline(device, pipelines.depthPrepass, nullptr);
+    vkDestroyPipeline(device, pipelines.depthEqual, nullptr);
+}
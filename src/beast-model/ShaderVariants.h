@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+class PipelineCompiler;
+
+/*
+ * Material dependent features of main.frag, compiled in or out through specialization constants
+ * so a single SPIR-V binary gives a pipeline per feature combination without branching per fragment.
+ *
+ *   constant_id 0  bool   USE_TEXTURE       sample texSampler, otherwise white
+ *   constant_id 1  bool   USE_VERTEX_COLOR  modulate by interpolated vertex color
+ *   constant_id 2  bool   ALPHA_TEST        discard fragments below ALPHA_CUTOFF
+ *   constant_id 3  float  ALPHA_CUTOFF
+ */
+struct ShaderVariant {
+    bool useTexture = true;
+    bool useVertexColor = false;
+    float alphaCutoff = 0.0f;       // alpha test is off at 0
+
+    bool isAlphaTested() const { return alphaCutoff > 0.0f; }
+    // unique per combination of constants, cutoff is compared bitwise
+    uint64_t getKey() const;
+};
+
+/*
+ * Pipelines of each shader variant, created through the creator callback and kept until clear(),
+ * which has to be called whenever anything else baked into pipelines (render pass, sample count,
+ * sample shading) changes.
+ *
+ * Without a compiler, pipelines are created on first get() on the calling thread. With one, get()
+ * queues the variant on compiler's threads and hands out the fallback variant's pipelines (created
+ * right away by setFallback()) until collectCompiled() picks up the result, so the creator has to be
+ * safe to call from other threads. Specialization info handed to the creator is only valid for the
+ * duration of the call.
+ *
+ * Stall time is what the calling thread spent creating pipelines, or waiting for the compiler.
+ */
+class ShaderVariantCache {
+public:
+    struct Pipelines {
+        VkPipeline shade = VK_NULL_HANDLE;          // LESS depth test with depth writes
+        VkPipeline depthPrepass = VK_NULL_HANDLE;   // depth only, fragment shader is kept only if alpha tested
+        VkPipeline depthEqual = VK_NULL_HANDLE;     // shading after depth pre-pass, EQUAL test without depth writes
+    };
+
+    using Creator = std::function<Pipelines(const ShaderVariant& variant, const VkSpecializationInfo& specializationInfo)>;
+
+    void init(VkDevice device, Creator creator, PipelineCompiler* compiler = nullptr);
+    void cleanup();
+
+    void setFallback(const ShaderVariant& variant);
+    // fallback is created with the new creator first, and the cache is left as it was if that throws,
+    // otherwise all other variants are destroyed, and re-created on next get()
+    void replaceCreator(Creator newCreator);
+    // start compiling ahead of first get(), no-op without compiler
+    void prepare(const ShaderVariant& variant);
+    // pipelines of variant, or fallback's while variant is being compiled
+    const Pipelines& get(const ShaderVariant& variant);
+    // move compiled pipelines into cache, true if there were any (command buffers recorded with fallback
+    // should be re-recorded), rethrows creator's exception after that, failed variant keeps using fallback
+    bool collectCompiled();
+    // destroy pipelines of all variants, they are re-created on next get()
+    void clear();
+
+    size_t getNumCached() const { return variants.size(); }
+    size_t getNumCompiling() const { return compiling.size(); }
+    uint32_t getNumCreated() const { return numCreated; }  // since init(), counts re-creation after clear()
+    double getStallMs() const { return stallMs; }
+    double getCompileMs() const;        // summed over compiler's threads
+
+private:
+    Pipelines create(const Creator& variantCreator, const ShaderVariant& variant);
+    void destroy(const Pipelines& pipelines);
+
+    VkDevice device = VK_NULL_HANDLE;
+    Creator creator;
+    PipelineCompiler* compiler = nullptr;
+    std::unordered_map<uint64_t, Pipelines> variants;
+    std::unordered_set<uint64_t> compiling;
+    ShaderVariant fallbackVariant;
+    uint64_t fallbackKey = 0;
+    bool hasFallback = false;
+    std::atomic<uint32_t> numCreated{0};
+    double stallMs = 0.0;
+
+    // written by compiler's threads
+    mutable std::mutex compiledMutex;
+    std::vector<std::pair<uint64_t, Pipelines>> compiled;
+    std::exception_ptr compileError;
+    double compileMs = 0.0;
+};
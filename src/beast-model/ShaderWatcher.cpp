@@ -0,0 +1,150 @@
+#include "ShaderWatcher.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+const int QUIET_PERIOD_MS = 100;    // sources are compiled once no event arrived for this long
+
+static bool isShaderSource(const std::string& name) {
+    static const char* extensions[] = { ".vert", ".frag", ".comp", ".geom", ".tesc", ".tese" };
+    for (const char* extension : extensions) {
+        const std::string suffix(extension);
+        if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+            return true;
+    }
+    return false;
+}
+
+ShaderWatcher::~ShaderWatcher() {
+    stop();
+}
+
+std::string ShaderWatcher::getOutputName(const std::string& sourceName) {
+    const size_t dot = sourceName.find_last_of('.');
+    const std::string stem = sourceName.substr(0, dot);
+    const std::string stage = sourceName.substr(dot + 1);
+    return (stem == "main" ? stage : stem) + ".spv";
+}
+
+#ifdef __linux__
+bool ShaderWatcher::start(const std::string& directory) {
+    this->directory = directory;
+    const char* sdk = std::getenv("VULKAN_SDK");
+    compiler = sdk != nullptr ? std::string(sdk) + "/bin/glslc" : "glslc";
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+        return false;
+    // editors either rewrite in place, or write a new file, and rename it over
+    if (inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+
+    isStopping = false;
+    thread = std::thread(&ShaderWatcher::watchLoop, this);
+    return true;
+}
+
+void ShaderWatcher::stop() {
+    if (!thread.joinable())
+        return;
+    isStopping = true;
+    thread.join();
+    close(inotifyFd);
+    inotifyFd = -1;
+}
+
+void ShaderWatcher::watchLoop() {
+    std::set<std::string> pending;
+    alignas(inotify_event) char buffer[4096];
+
+    while (!isStopping) {
+        pollfd fd = {};
+        fd.fd = inotifyFd;
+        fd.events = POLLIN;
+        const int ready = poll(&fd, 1, QUIET_PERIOD_MS);
+
+        if (ready > 0) {
+            const ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+            for (ssize_t offset=0; offset<length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0 && isShaderSource(event->name))
+                    pending.insert(event->name);
+                offset += sizeof(inotify_event) + event->len;
+            }
+            continue;
+        }
+
+        for (const std::string& source : pending) {
+            if (compile(source)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                compiled.push_back(getOutputName(source));
+            }
+        }
+        pending.clear();
+    }
+}
+
+bool ShaderWatcher::compile(const std::string& sourceName) {
+    const std::string output = directory + "/" + getOutputName(sourceName);
+    const std::string temporary = output + ".tmp";
+    const std::string command = "\"" + compiler + "\" \"" + directory + "/" + sourceName + "\" -o \"" + temporary + "\" 2>&1";
+
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        std::cerr << "Shader reload: failed to run " << compiler << '\n';
+        return false;
+    }
+    std::string log;
+    char line[256];
+    while (std::fgets(line, sizeof(line), pipe) != nullptr)
+        log += line;
+    const int status = pclose(pipe);
+
+    if (status != 0) {
+        std::cerr << "Shader reload: " << sourceName << " failed to compile\n" << log;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    if (std::rename(temporary.c_str(), output.c_str()) != 0) {
+        std::cerr << "Shader reload: failed to replace " << output << '\n';
+        return false;
+    }
+    return true;
+}
+#else
+bool ShaderWatcher::start(const std::string& directory) {
+    this->directory = directory;
+    return false;
+}
+
+void ShaderWatcher::stop() {
+}
+
+void ShaderWatcher::watchLoop() {
+}
+
+bool ShaderWatcher::compile(const std::string&) {
+    return false;
+}
+#endif
+
+std::vector<std::string> ShaderWatcher::takeCompiled() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> result;
+    result.swap(compiled);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Watches shaders directory with inotify, and recompiles GLSL sources once they've been written
+ * (after a short quiet period, editors tend to write in several steps) on a background thread.
+ * Outputs follow shaders/compile.sh, main.vert -> vert.spv, main.frag -> frag.spv, and any other
+ * <name>.<stage> -> <name>.spv, written to a temporary file first then renamed so a reader never
+ * sees a partial module. glslc is taken from $VULKAN_SDK/bin, otherwise from PATH.
+ *
+ * Linux only, elsewhere start() returns false.
+ */
+class ShaderWatcher {
+public:
+    ~ShaderWatcher();
+
+    bool start(const std::string& directory);
+    void stop();
+    bool isRunning() const { return thread.joinable(); }
+
+    // SPIR-V file names (without directory) compiled successfully since the last call
+    std::vector<std::string> takeCompiled();
+
+    static std::string getOutputName(const std::string& sourceName);
+
+private:
+    void watchLoop();
+    bool compile(const std::string& sourceName);
+
+    std::string directory;
+    std::string compiler;
+    int inotifyFd = -1;
+    std::thread thread;
+    std::atomic<bool> isStopping{false};
+
+    std::mutex mutex;
+    std::vector<std::string> compiled;
+};
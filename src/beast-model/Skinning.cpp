@@ -0,0 +1,71 @@
+#include "Skinning.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+const float TWIST_AMPLITUDE = glm::radians(25.0f);  // at the top bone
+const float TWIST_SPEED = 2.0f;                     // radians per second
+const float TWIST_PHASE = 0.6f;                     // between neighbouring bones
+
+void buildSkinInfluences(const Vertex* vertices, size_t count, SkinInfluence* outInfluences) {
+    if (count == 0)
+        return;
+
+    float minZ = vertices[0].pos.z;
+    float maxZ = vertices[0].pos.z;
+    for (size_t i=1; i<count; ++i) {
+        minZ = std::min(minZ, vertices[i].pos.z);
+        maxZ = std::max(maxZ, vertices[i].pos.z);
+    }
+    const float height = maxZ > minZ ? maxZ - minZ : 1.0f;
+
+    for (size_t i=0; i<count; ++i) {
+        // position along the chain of bones, blend between the bone below, and the one above
+        const float t = (vertices[i].pos.z - minZ) / height * (MAX_SKIN_BONES - 1);
+        const uint32_t lower = std::min(static_cast<uint32_t>(t), MAX_SKIN_BONES - 2);
+        const float upperWeight = std::min(std::max(t - lower, 0.0f), 1.0f);
+
+        SkinInfluence& influence = outInfluences[i];
+        influence.bones[0] = lower;
+        influence.bones[1] = lower + 1;
+        influence.bones[2] = 0;
+        influence.bones[3] = 0;
+        influence.weights[0] = 1.0f - upperWeight;
+        influence.weights[1] = upperWeight;
+        influence.weights[2] = 0.0f;
+        influence.weights[3] = 0.0f;
+    }
+}
+
+BonePalette computeBonePalette(float time) {
+    BonePalette palette;
+    for (uint32_t b=0; b<MAX_SKIN_BONES; ++b) {
+        const float reach = static_cast<float>(b) / (MAX_SKIN_BONES - 1);
+        const float angle = TWIST_AMPLITUDE * reach * std::sin(time * TWIST_SPEED + b * TWIST_PHASE);
+        palette.bones[b] = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+    return palette;
+}
+
+void skinVertices(const Vertex* source, const SkinInfluence* influences, const BonePalette& palette, Vertex* output, size_t count) {
+    for (size_t i=0; i<count; ++i) {
+        const SkinInfluence& influence = influences[i];
+        const glm::mat4 skin = influence.weights[0] * palette.bones[influence.bones[0]] +
+                               influence.weights[1] * palette.bones[influence.bones[1]] +
+                               influence.weights[2] * palette.bones[influence.bones[2]] +
+                               influence.weights[3] * palette.bones[influence.bones[3]];
+
+        output[i].pos = glm::vec3(skin * glm::vec4(source[i].pos, 1.0f));
+        output[i].color = source[i].color;
+        output[i].texCoord = source[i].texCoord;
+    }
+}
+
+float maxSkinningError(const Vertex* a, const Vertex* b, size_t count) {
+    float maxError = 0.0f;
+    for (size_t i=0; i<count; ++i)
+        maxError = std::max(maxError, glm::length(a[i].pos - b[i].pos));
+    return maxError;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// has to match MAX_BONES in shaders/skin.comp
+const uint32_t MAX_SKIN_BONES = 4;
+
+// bone influences of a vertex, layout matches std430 SkinInfluence in shaders/skin.comp
+struct SkinInfluence {
+    uint32_t bones[4];
+    float weights[4];
+};
+
+// bone matrices for one frame, layout matches std140 uniform block in shaders/skin.comp
+struct BonePalette {
+    glm::mat4 bones[MAX_SKIN_BONES];
+};
+
+/*
+ * Linear-blend skinning with a procedural rig, as meshes don't come with a skeleton.
+ * Bones are stacked along z (up axis of the scene), each vertex is weighted between
+ * the two nearest bones by its height within the mesh's bounds. Bones twist around z,
+ * more so towards the top, so the mesh sways.
+ *
+ * skinVertices() is the CPU reference of shaders/skin.comp, used to verify GPU output,
+ * and as a baseline for benchmarks.
+ */
+void buildSkinInfluences(const Vertex* vertices, size_t count, SkinInfluence* outInfluences);
+BonePalette computeBonePalette(float time);
+void skinVertices(const Vertex* source, const SkinInfluence* influences, const BonePalette& palette, Vertex* output, size_t count);
+
+// largest distance between positions of the same vertex
+float maxSkinningError(const Vertex* a, const Vertex* b, size_t count);
@@ -1,27 +1,28 @@
 #include "VkBase.h"
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include "GoldenImage.h"
 
 #include <chrono>
+#include <future>
 #include <map>
-#include <queue>
-#include <tuple>
-#include <fstream>
 #include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 #include <set>
 #include <cstring>
 #include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
 
 const std::string MODEL_PATH = "../../assets/MythicalBeast/mythical-beast.obj";
 const std::string TEXTURE_PATH = "../../assets/MythicalBeast/Lev-edinorog_complete_0.png";
 
 const float FPS_GRANULARITY_SEC = 1.0f; // how often to update FPS
-char title[50];
+const float GEOMETRY_ARENA_HEADROOM = 1.5f;  // arena capacity relative to geometry loaded at startup
+const uint32_t SKINNING_WORKGROUP_SIZE = 64;    // local_size_x of shaders/skin.comp
+const float SKINNING_TOLERANCE = 1e-4f;         // max position error of GPU skinning against CPU reference
+const float GOLDEN_TIME_SEC = 0.5f;             // animation time of golden image frames unless set otherwise
+char title[256];
 
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
@@ -54,39 +55,144 @@ struct UniformBufferObject {
     glm::mat4 proj;
 };
 
-// help function for reading file
-static std::vector<char> readFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+struct SkinningPushConstants {
+    uint32_t sourceFirstVertex;
+    uint32_t outputFirstVertex;
+    uint32_t vertexCount;
+};
 
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file!");
+static double elapsedMs(std::chrono::steady_clock::time_point& since) {
+    const auto now = std::chrono::steady_clock::now();
+    const double ms = std::chrono::duration<double, std::milli>(now - since).count();
+    since = now;
+    return ms;
+}
+
+void VkBase::init(const int width, const int height, std::string title, const VkBaseOptions& options) {
+    this->options = options;
+    int windowWidth = width;
+    int windowHeight = height;
+    // replay recreates what capture was made with, and presents as fast as possible without a window
+    if (!options.replayPath.empty()) {
+        if (!frameCapture.openRead(options.replayPath, replayHeader))
+            throw std::runtime_error("failed to read frame capture!");
+        this->options.scenePath = replayHeader.scenePath;
+        this->options.swapChainImageCount = replayHeader.swapChainImageCount;
+        this->options.depthPrepass = replayHeader.depthPrepass;
+        this->options.deformation = replayHeader.deformation;
+        this->options.asyncCompute = replayHeader.asyncCompute;
+        this->options.msaaSamples = replayHeader.settings.msaaSamples;
+        this->options.sampleShading = replayHeader.settings.sampleShading;
+        this->options.headless = true;
+        this->options.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        this->options.framePacing = false;
+        this->options.frameBudgetMs = 0.0;
+        this->options.asyncPipelines = false;
+        windowWidth = static_cast<int>(replayHeader.settings.width);
+        windowHeight = static_cast<int>(replayHeader.settings.height);
+    }
+    if (options.benchDepthPrepass > 0 || options.checkPipelineStatistics)
+        this->options.pipelineStatistics = true;
+    // golden frames have to be reproducible, every variant is compiled before it's drawn, and time doesn't advance
+    if (!options.goldenPath.empty()) {
+        this->options.asyncPipelines = false;
+        if (options.fixedTime < 0.0f)
+            this->options.fixedTime = GOLDEN_TIME_SEC;
+    }
+    if (!options.tracePath.empty()) {
+        profiler.setOutputPath(options.tracePath);
+        profiler.setEnabled(true);
+    }
+    // hot reload writes recompiled modules next to sources, which take precedence over embedded ones
+    shaderLibrary.setOverrideDirectory(options.shaderDirectory.empty() && options.hotReload ? "shaders" : options.shaderDirectory);
+    startupBegin = std::chrono::steady_clock::now();
+    auto phaseStart = startupBegin;
+    initWindow(windowWidth, windowHeight, title);
+    startupStats.windowMs = elapsedMs(phaseStart);
+    if (options.listDevices) {
+        listDevices();
+        return;
     }
-
-    size_t fileSize = static_cast<size_t>(file.tellg());
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-    return buffer;
-}
-
-void VkBase::init(const int width, const int height, std::string title) {
-    initWindow(width, height, title);
     initVulkan();
 }
 
-void VkBase::run() {
-    mainLoop();
+int VkBase::run() {
+    if (options.listDevices)
+        return 0;
+
+    int status = 0;
+    if (!options.capturePath.empty())
+        startCapture();
+
+    if (!options.replayPath.empty())
+        status = runReplay();
+    else if (options.benchDescriptorSets > 0)
+        runDescriptorBenchmark();
+    else if (options.benchResizes > 0)
+        runResizeBenchmark();
+    else if (options.benchGeometry > 0)
+        runGeometryBenchmark();
+    else if (options.benchSkinning > 0)
+        runSkinningBenchmark();
+    else if (options.benchDepthPrepass > 0)
+        runDepthPrepassBenchmark();
+    else if (options.checkPipelineStatistics)
+        status = runPipelineStatisticsCheck();
+    else if (!options.goldenPath.empty())
+        status = runGoldenImageCheck();
+    else if (options.benchStartup) {
+        // time-to-first-frame includes a single presented frame
+        pollEvents();
+        drawFrame();
+        vkDeviceWaitIdle(device);
+        printStartupStats();
+    }
+    else if (options.headless) {
+        std::cerr << "Headless: there's no window to run main loop in, use --golden or a benchmark\n";
+        status = 1;
+    }
+    else
+        mainLoop();
     cleanup();
+    return status;
 }
 
 void VkBase::initWindow(const int width, const int height, std::string title) {
+    framePacer.setEnabled(options.framePacing);
+    framePacer.setTargetFrameRate(options.targetFrameRate);
+
+    // no GLFW at all, so it runs where there's no display (e.g. CI with a software ICD)
+    if (options.headless) {
+        headlessExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+        return;
+    }
+
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    // listing checks present support against the same kind of surface a normal run uses, but shows no window
+    if (options.listDevices)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
     windowTitle = title;    // save window's title for later use
     window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
     glfwSetWindowUserPointer(window, this);
     glfwSetFramebufferSizeCallback(window, VkBase::framebufferResizeCallback);
+    glfwSetKeyCallback(window, VkBase::keyCallback);
+}
+
+void VkBase::getFramebufferSize(int& width, int& height) const {
+    if (options.headless) {
+        width = static_cast<int>(headlessExtent.width);
+        height = static_cast<int>(headlessExtent.height);
+    }
+    else {
+        glfwGetFramebufferSize(window, &width, &height);
+    }
+}
+
+// no GLFW while headless, so check modes, and benchmarks poll through here
+void VkBase::pollEvents() {
+    if (!options.headless)
+        glfwPollEvents();
 }
 
 void VkBase::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
@@ -94,48 +200,168 @@ void VkBase::framebufferResizeCallback(GLFWwindow* window, int width, int height
     app->framebufferResized = true;
 }
 
+void VkBase::keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int /*mods*/) {
+    if (action != GLFW_PRESS)
+        return;
+
+    auto app = reinterpret_cast<VkBase*>(glfwGetWindowUserPointer(window));
+    switch (key) {
+        // cycle through presentation modes, swapchain is recreated at the end of current frame
+        case GLFW_KEY_P:
+        {
+            const VkPresentModeKHR modes[] = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+            const size_t numModes = sizeof(modes) / sizeof(modes[0]);
+            size_t next = 0;
+            for (size_t i=0; i<numModes; ++i) {
+                if (modes[i] == app->options.presentMode) {
+                    next = (i + 1) % numModes;
+                    break;
+                }
+            }
+            app->options.presentMode = modes[next];
+            app->swapChainSettingsChanged = true;
+            break;
+        }
+        // toggle frame pacing
+        case GLFW_KEY_F:
+            app->options.framePacing = !app->options.framePacing;
+            app->framePacer.setEnabled(app->options.framePacing);
+            std::cout << "Frame pacing: " << (app->options.framePacing ? "on" : "off") << '\n';
+            break;
+        // cycle MSAA sample count from the highest usable down to 1x
+        case GLFW_KEY_M:
+            app->msaaSamples = app->msaaSamples > VK_SAMPLE_COUNT_1_BIT ? static_cast<VkSampleCountFlagBits>(app->msaaSamples >> 1) : app->maxMsaaSamples;
+            app->qualityGovernor.setCeiling(app->msaaSamples, app->isSampleShadingEnabled);
+            app->qualitySettingsChanged = true;
+            break;
+        // start, or stop (and write) trace
+        case GLFW_KEY_T:
+            app->profilerToggled = true;
+            break;
+        // toggle sample shading
+        case GLFW_KEY_S:
+            app->isSampleShadingEnabled = !app->isSampleShadingEnabled;
+            app->qualityGovernor.setCeiling(app->msaaSamples, app->isSampleShadingEnabled);
+            app->qualitySettingsChanged = true;
+            break;
+    }
+}
+
 void VkBase::initVulkan() {
+    auto initStart = std::chrono::steady_clock::now();
+    auto phaseStart = initStart;
+    ProfileZone phase(profiler, "init: device");
+
+    // asset paths are known upfront, so parsing, and decoding overlap with device setup below,
+    // deferred launch runs them on main thread at the point of finishLoad() instead
+    const Scene scene = options.scenePath.empty() ? Scene::makeSingleModel(MODEL_PATH, TEXTURE_PATH) : Scene::loadFromFile(options.scenePath);
+    resourceManager.beginLoad(scene, options.parallelAssetLoading ? std::launch::async : std::launch::deferred, profiler);
+    isDepthPrepassEnabled = options.depthPrepass || scene.depthPrepass;
+
     createInstance();
     setupDebugMessenger();
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
+    createTimelineSemaphores();
+    createPipelineCompiler();
+    startupStats.deviceMs = elapsedMs(phaseStart);
+    phase.next("init: swapchain");
+
     createSwapChain();
     createImageViews();
     createRenderPass();
+    createDescriptorAllocator();
+    reflectShaders();
     createDescriptorSetLayout();
     createGraphicsPipeline();
+    if (options.deformation)
+        createSkinningPipeline();
     createCommandPool();
     createColorResources();
     createDepthResources();
     createFramebuffers();
-    createTextureImage();
-    createTextureImageView();
+    startupStats.swapChainMs = elapsedMs(phaseStart);
+    phase.next("init: asset wait");
+
+    // join loaders just before upload
+    resourceManager.finishLoad();
+    startupStats.assetWaitMs = elapsedMs(phaseStart);
+    phase.next("init: upload");
+    startupStats.textureDecodeMs = resourceManager.getStats().textureDecodeMs;
+    startupStats.modelParseMs = resourceManager.getStats().modelParseMs;
+
+    // uploads are recorded into one command buffer, and waited on once
+    if (options.batchUploads)
+        beginUploadBatch();
+    createTextureImages();
     createTextureSampler();
 
-    loadModel();
-    /* warning: we could better off create a single large buffer holding all sub-buffers and use offset to locate each type of buffer for better efficiency. */
-    createVertexBuffer();
-    createIndexBuffer();
+    // every mesh lives in the same buffer at its own offsets
+    createGeometryBuffer();
+    if (options.deformation)
+        createSkinningBuffers();
+    if (options.batchUploads)
+        flushUploadBatch();
+    resourceManager.releaseTexturePixels();
+    startupStats.uploadMs = elapsedMs(phaseStart);
+    phase.next("init: per-image");
+
     createUniformBuffers();
-    createDescriptorPool();
+    if (options.deformation)
+        createSkinningOutputs();
     createDescriptorSets();
     createCommandBuffers();
     createSyncObjects();
+    startupStats.perImageMs = elapsedMs(phaseStart);
+
+    startupStats.initMs = elapsedMs(initStart);
 }
 
 void VkBase::mainLoop() {
+    if (options.hotReload) {
+        const std::string& directory = shaderLibrary.getOverrideDirectory();
+        if (shaderWatcher.start(directory))
+            std::cout << "Shader hot reload: watching " << directory << "/\n";
+        else
+            std::cerr << "Shader hot reload: can't watch " << directory << "/ on this platform\n";
+    }
+
+    auto lastFrameTime = std::chrono::steady_clock::now();
     while (!glfwWindowShouldClose(window)) {
+        // sample input as late as possible to minimize input-to-photon latency
+        framePacer.waitForInputSample();
         glfwPollEvents();
         drawFrame();
 
+        const auto frameTime = std::chrono::steady_clock::now();
+        if (qualityGovernor.update(std::chrono::duration<double, std::milli>(frameTime - lastFrameTime).count())) {
+            msaaSamples = qualityGovernor.getLevel().samples;
+            isSampleShadingEnabled = qualityGovernor.getLevel().sampleShading;
+            qualitySettingsChanged = true;
+        }
+        lastFrameTime = frameTime;
+
         ++numRenderedFrames;
         const double currTime = glfwGetTime();
         const double diffTime = currTime - prevTime;
         if (diffTime >= FPS_GRANULARITY_SEC) {
             prevTime = currTime;
             fps = numRenderedFrames / diffTime;
-            std::snprintf(title, sizeof(title), "%s: %.2f FPS", windowTitle.c_str(), fps);
+            FramePacer::PresentStats presentStats = framePacer.getPresentStats();
+            int length = std::snprintf(title, sizeof(title), "%s: %.2f FPS [%s, present %.2f ms +/- %.2f ms%s] [%ux MSAA%s%s]", windowTitle.c_str(), fps, getPresentModeString(swapChainPresentMode).c_str(), presentStats.avgMs, presentStats.jitterMs, framePacer.isEnabled() ? ", paced" : "",
+                    static_cast<uint32_t>(msaaSamples), isSampleShadingEnabled && msaaSamples > VK_SAMPLE_COUNT_1_BIT ? ", sample shading" : "", qualityGovernor.isEnabled() ? ", governed" : "");
+            if (options.memoryReport && length > 0 && static_cast<size_t>(length) < sizeof(title)) {
+                length += std::snprintf(title + length, sizeof(title) - length, " [%.0f / %.0f MB]",
+                        memoryTracker.getDeviceLocalUsage() / (1024.0 * 1024.0), memoryTracker.getDeviceLocalBudget() / (1024.0 * 1024.0));
+            }
+            // averaged over frames collected since the last update
+            if (pipelineStatistics.isEnabled() && pipelineStatistics.getNumSamples() > 0 && length > 0 && static_cast<size_t>(length) < sizeof(title)) {
+                PipelineStatistics::Counters stats = pipelineStatistics.getAverage();
+                std::snprintf(title + length, sizeof(title) - length, " [%.2fK verts, %.2fK prims, %.2fK clipped, %.2fM frags]",
+                        stats.vertexShaderInvocations / 1000.0, stats.inputAssemblyPrimitives / 1000.0, stats.clippingPrimitives / 1000.0, stats.fragmentShaderInvocations / 1000000.0);
+                pipelineStatistics.resetAverage();
+            }
             glfwSetWindowTitle(window, title);
             numRenderedFrames = 0;
         }
@@ -145,6 +371,8 @@ void VkBase::mainLoop() {
 }
 
 void VkBase::drawFrame() {
+    ProfileZone frame(profiler, "frame");
+    ProfileZone zone(profiler, "acquire");
     semaphoreIndex = (semaphoreIndex + 1) % imageAvailableSemaphores.size();
     uint32_t imageIndex;
     VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[semaphoreIndex], VK_NULL_HANDLE, &imageIndex);
@@ -156,38 +384,79 @@ void VkBase::drawFrame() {
     else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
         throw std::runtime_error("failed to acquire swap chain image!");
     }
-
-    vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
-    vkResetFences(device, 1, &imagesInFlight[imageIndex]);
-
-    updateUniformBuffer(imageIndex);
+    if (retiredSwapChain != VK_NULL_HANDLE) {
+        vkDestroySwapchainKHR(device, retiredSwapChain, nullptr);
+        retiredSwapChain = VK_NULL_HANDLE;
+    }
+
+    // wait until GPU finished the last frame that used this image's command buffer, and uniform buffer
+    zone.next("wait for image");
+    waitTimelineSemaphore(graphicsTimeline, imageTimelineValues[imageIndex]);
+    framePacer.beginWork();
+    if (pipelineStatistics.isEnabled())
+        pipelineStatistics.collect(imageIndex, lastPipelineStatistics);
+    if (profiler.hasGpu())
+        profiler.collectGpuFrame(imageIndex);
+
+    zone.next("update uniforms");
+    // replayed frame brings its own inputs
+    const FrameCapture::Frame input = isReplaying ? replayFrame : sampleFrameInput();
+    updateUniformBuffer(imageIndex, input.model);
+    if (options.deformation)
+        updateSkinningPalette(imageIndex, input.time);
+    if (frameCapture.isRecording())
+        frameCapture.writeFrame(getCaptureSettings(), input);
+
+    zone.next("submit");
+    if (isAsyncCompute)
+        submitSkinning(imageIndex);
 
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     // - setup semaphore to wait before submitting the command buffer
-    VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[semaphoreIndex] };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    // deformed vertices from async compute are only needed once vertex input starts
+    VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[semaphoreIndex], computeTimeline };
+    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT };
+    uint64_t waitValues[] = { 0, computeTimelineValue };    // value for binary semaphore is ignored
 
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = isAsyncCompute ? 2 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffers[imageIndex];   // hook it up with already recoreded command buffer
 
     // - setup semaphore to signal when the command buffer done their job
-    VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[semaphoreIndex] };
+    // binary semaphore for presentation engine, timeline semaphore for tracking frame's progress
+    const uint64_t frameValue = ++graphicsTimelineValue;
+    VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[semaphoreIndex], graphicsTimeline };
+    uint64_t signalValues[] = { 0, frameValue };    // value for binary semaphore is ignored
     
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = 2;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, imagesInFlight[imageIndex]) != VK_SUCCESS) {
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount = 2;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+    submitInfo.pNext = &timelineInfo;
+
+    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
+    framePacer.endWork();
+    imageTimelineValues[imageIndex] = frameValue;
+    if (pipelineStatistics.hasQuery(imageIndex))
+        pipelineStatistics.markSubmitted(imageIndex);
+    if (isProfilerRecorded)
+        profiler.markSubmitted(imageIndex);
 
+    zone.next("present");
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores; // wait until render finished
+    presentInfo.pWaitSemaphores = &renderFinishedSemaphores[semaphoreIndex]; // wait until render finished
 
     VkSwapchainKHR swapChains[] = { swapChain };
     presentInfo.swapchainCount = 1;
@@ -195,39 +464,222 @@ void VkBase::drawFrame() {
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = nullptr;
     result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    framePacer.onPresent();
+
+    if (!isFirstFramePresented) {
+        startupStats.firstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count();
+        isFirstFramePresented = true;
+    }
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized || swapChainSettingsChanged) {
         recreateSwapChain();
         framebufferResized = false;
+        swapChainSettingsChanged = false;
     }
     else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to present swap chain image!");
     }
+
+    if (qualitySettingsChanged) {
+        applyQualitySettings();
+        qualitySettingsChanged = false;
+    }
+    if (profilerToggled) {
+        toggleProfiler();
+        profilerToggled = false;
+    }
+    if (shaderWatcher.isRunning())
+        reloadShaders();
+    // draws recorded with fallback pipelines switch over to their variants once compiled
+    bool isVariantCompiled = false;
+    try {
+        isVariantCompiled = pipelineVariants.collectCompiled();
+    }
+    catch (const std::exception& e) {
+        // failed variant keeps drawing with fallback, others compiled along may still have to be picked up
+        std::cerr << "Pipeline variant: " << e.what() << '\n';
+        isVariantCompiled = true;
+    }
+    if (isVariantCompiled) {
+        waitTimelineSemaphore(graphicsTimeline, graphicsTimelineValue);
+        recordCommandBuffers();
+    }
 }
 
-void VkBase::cleanup() {
-    cleanupSwapChain();
+// swap in pipelines of shaders recompiled by the watcher, at frame boundary once frames in flight (which
+// reference old pipelines) retired, descriptor sets, and layouts are kept so reflection has to match
+// new pipelines are created before old ones are destroyed, so a shader failing to load, or compile keeps the old ones
+void VkBase::reloadShaders() {
+    const std::vector<std::string> reloaded = shaderWatcher.takeCompiled();
+    const bool isMainChanged = std::find(reloaded.begin(), reloaded.end(), "vert.spv") != reloaded.end() ||
+                               std::find(reloaded.begin(), reloaded.end(), "frag.spv") != reloaded.end();
+    const bool isSkinningChanged = options.deformation && std::find(reloaded.begin(), reloaded.end(), "skin.spv") != reloaded.end();
+    if (!isMainChanged && !isSkinningChanged)
+        return;
 
-    vkDestroySampler(device, textureSampler, nullptr);
-    vkDestroyImageView(device, textureImageView, nullptr);
-    vkDestroyImage(device, textureImage, nullptr);
-    vkFreeMemory(device, textureImageMemory, nullptr);
+    ProfileZone zone(profiler, "reload shaders");
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    VkShaderModule newVertShaderModule = VK_NULL_HANDLE;
+    VkShaderModule newFragShaderModule = VK_NULL_HANDLE;
+    VkPipeline newSkinningPipeline = VK_NULL_HANDLE;
+    try {
+        ShaderReflection mainReflection;
+        ShaderReflection skinReflection;
+        std::vector<char> vertShaderCode;
+        std::vector<char> fragShaderCode;
+        std::vector<char> compShaderCode;
+        if (isMainChanged) {
+            vertShaderCode = shaderLibrary.load("vert.spv");
+            fragShaderCode = shaderLibrary.load("frag.spv");
+            mainReflection.addModule(vertShaderCode);
+            mainReflection.addModule(fragShaderCode);
+        }
+        if (isSkinningChanged) {
+            compShaderCode = shaderLibrary.load("skin.spv");
+            skinReflection.addModule(compShaderCode);
+        }
+        if ((isMainChanged && !mainReflection.isLayoutCompatible(shaderReflection)) || (isSkinningChanged && !skinReflection.isLayoutCompatible(skinningShaderReflection)))
+            throw std::runtime_error("bindings, push constants, or vertex inputs changed, restart to apply");
+
+        // pipeline layouts are kept as they are built from identical reflection
+        if (isSkinningChanged)
+            newSkinningPipeline = createSkinningComputePipeline(compShaderCode);
+        if (isMainChanged) {
+            newVertShaderModule = createShaderModule(vertShaderCode);
+            newFragShaderModule = createShaderModule(fragShaderCode);
+            waitTimelineSemaphore(graphicsTimeline, graphicsTimelineValue);
+            pipelineVariants.replaceCreator(getVariantCreator(newVertShaderModule, newFragShaderModule));
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Shader reload: " << e.what() << '\n';
+        if (newSkinningPipeline != VK_NULL_HANDLE)
+            vkDestroyPipeline(device, newSkinningPipeline, nullptr);
+        if (newFragShaderModule != VK_NULL_HANDLE)
+            vkDestroyShaderModule(device, newFragShaderModule, nullptr);
+        if (newVertShaderModule != VK_NULL_HANDLE)
+            vkDestroyShaderModule(device, newVertShaderModule, nullptr);
+        return;
+    }
 
-    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+    waitTimelineSemaphore(graphicsTimeline, graphicsTimelineValue);
+    if (isMainChanged) {
+        // old variants are gone, nothing compiles from old modules anymore
+        vkDestroyShaderModule(device, fragShaderModule, nullptr);
+        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+        vertShaderModule = newVertShaderModule;
+        fragShaderModule = newFragShaderModule;
+        for (const ResourceManager::Material& material : resourceManager.getMaterials())
+            pipelineVariants.prepare(material.variant);
+    }
+    // graphics waits on deformation, so retired graphics frames imply their compute work is done as well
+    if (isSkinningChanged) {
+        vkDestroyPipeline(device, skinningPipeline, nullptr);
+        skinningPipeline = newSkinningPipeline;
+    }
+    recordCommandBuffers();
 
-    vkDestroyBuffer(device, indexBuffer, nullptr);
-    vkFreeMemory(device, indexBufferMemory, nullptr);
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::cout << "Shader reload:";
+    for (const std::string& name : reloaded)
+        std::cout << ' ' << name;
+    std::cout << " (swapped in " << std::chrono::duration<double, std::milli>(endTime - startTime).count() << " ms)\n";
+}
 
-    vkDestroyBuffer(device, vertexBuffer, nullptr);
-    vkFreeMemory(device, vertexBufferMemory, nullptr);
+// timestamps are only recorded into command buffers while profiling, so they are re-recorded
+void VkBase::toggleProfiler() {
+    waitTimelineSemaphore(graphicsTimeline, graphicsTimelineValue);
+    if (profiler.isEnabled()) {
+        collectProfilerFrames();
+        profiler.setEnabled(false);
+        profiler.writeTrace();
+    }
+    else {
+        profiler.setEnabled(true);
+        std::cout << "Trace: recording, press T again to write " << profiler.getOutputPath() << '\n';
+    }
+    recordCommandBuffers();
+}
 
-    for (size_t i=0; i<swapChainImages.size(); ++i) {
-        vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-        vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-        vkDestroyFence(device, imagesInFlight[i], nullptr);
+// collect GPU ranges of frames which are submitted but not yet collected, GPU has to be idle
+void VkBase::collectProfilerFrames() {
+    if (!profiler.hasGpu())
+        return;
+    for (uint32_t image=0; image<static_cast<uint32_t>(swapChainImages.size()); ++image)
+        profiler.collectGpuFrame(image);
+}
+
+void VkBase::cleanup() {
+    shaderWatcher.stop();
+    if (frameCapture.isRecording()) {
+        frameCapture.close();
+        std::printf("Frame capture: %u frame(s), %llu bytes written to %s\n", frameCapture.getNumFrames(),
+                static_cast<unsigned long long>(frameCapture.getNumBytes()), options.capturePath.c_str());
+    }
+    if (profiler.isEnabled()) {
+        collectProfilerFrames();
+        profiler.setEnabled(false);
+        profiler.writeTrace();
+    }
+#ifndef NDEBUG
+    // committed memory is only meaningful after attachments have been rendered to
+    printAttachmentFootprint();
+    std::printf("Shader variants: %zu cached, %u created, stalled %.3f ms, compiled %.3f ms off main thread\n",
+            pipelineVariants.getNumCached(), pipelineVariants.getNumCreated(), pipelineVariants.getStallMs(), pipelineVariants.getCompileMs());
+#endif
+    // live totals at exit, before anything is released, along with high-water marks
+#ifdef NDEBUG
+    if (options.memoryReport)
+#endif
+        memoryTracker.printStats();
+    cleanupSwapChain();
+    cleanupPerImageResources();
+    vkDestroySwapchainKHR(device, retiredSwapChain, nullptr);
+    vkDestroySwapchainKHR(device, swapChain, nullptr);
+    cleanupPipeline();
+
+    vkDestroySampler(device, textureSampler, nullptr);
+    for (const Texture& texture : textures) {
+        vkDestroyImageView(device, texture.view, nullptr);
+        vkDestroyImage(device, texture.image, nullptr);
+        memoryTracker.free(device, texture.memory);
     }
+
+#ifndef NDEBUG
+    descriptorAllocator.printStats("main");
+    printResizeStats();
+    if (!options.benchStartup)
+        printStartupStats();
+    geometryArena.printStats("main");
+#endif
+    descriptorAllocator.cleanup();
+    descriptorLayoutCache.cleanup();
+
+    if (options.deformation) {
+        vkDestroyPipeline(device, skinningPipeline, nullptr);
+        vkDestroyPipelineLayout(device, skinningPipelineLayout, nullptr);
+        vkDestroyBuffer(device, skinSourceBuffer, nullptr);
+        memoryTracker.free(device, skinSourceBufferMemory);
+        vkDestroyBuffer(device, skinInfluenceBuffer, nullptr);
+        memoryTracker.free(device, skinInfluenceBufferMemory);
+    }
+    geometryArena.cleanup();
+    pipelineCompiler.cleanup();
+
+    cleanupSyncObjects();
+    vkDestroySemaphore(device, graphicsTimeline, nullptr);
+    vkDestroySemaphore(device, uploadTimeline, nullptr);
+    vkDestroySemaphore(device, computeTimeline, nullptr);
+    if (computeCommandPool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(device, computeCommandPool, nullptr);
     vkDestroyCommandPool(device, commandPool, nullptr);
     vkDestroyDevice(device, nullptr);
+    cleanupInstance();
+}
+
+// what's left before any device is created
+void VkBase::cleanupInstance() {
 #ifdef ENABLE_VALIDATION_LAYERS
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 #endif
@@ -235,8 +687,10 @@ void VkBase::cleanup() {
     vkDestroySurfaceKHR(instance, surface, nullptr);
     vkDestroyInstance(instance, nullptr);
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (!options.headless) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 }
 
 void VkBase::createInstance() {
@@ -284,14 +738,7 @@ void VkBase::createInstance() {
 // get required vulkan instance extensions as required by glfw
 // per doc said, it will always include VK_KHR_surface if successfully returned
 std::vector<const char*> VkBase::getRequiredExtensions() const {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    std::vector<const char*> extensions;
-    for (int i=0; i<glfwExtensionCount; ++i) {
-        extensions.push_back(glfwExtensions[i]);
-    }
+    std::vector<const char*> extensions = getSurfaceExtensions();
 #ifdef ENABLE_VALIDATION_LAYERS
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
@@ -315,56 +762,135 @@ void VkBase::setupDebugMessenger() {
 #endif
 }
 
+// binary semaphores are only used at swapchain boundary (acquire, and present)
 void VkBase::createSyncObjects() {
     imageAvailableSemaphores.resize(swapChainImages.size());
     renderFinishedSemaphores.resize(swapChainImages.size());
-    imagesInFlight.resize(swapChainImages.size(), VK_NULL_HANDLE);
+    // value of 0 is already reached, so an image not used yet by any frame doesn't wait
+    imageTimelineValues.assign(swapChainImages.size(), 0);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
     for (size_t i=0; i<swapChainImages.size(); ++i) {
         if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device, &fenceInfo, nullptr, &imagesInFlight[i]) != VK_SUCCESS) {
+            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create synchronization objects from a frame!");
         }
     }
 }
 
+void VkBase::cleanupSyncObjects() {
+    for (size_t i=0; i<imageAvailableSemaphores.size(); ++i) {
+        vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
+        vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
+    }
+    imageAvailableSemaphores.clear();
+    renderFinishedSemaphores.clear();
+    imageTimelineValues.clear();
+    semaphoreIndex = 0;
+}
+
+// internal work is tracked by timeline semaphores, each submission signals the next (monotonically increasing) value
+void VkBase::createTimelineSemaphores() {
+    graphicsTimeline = createTimelineSemaphore();
+    uploadTimeline = createTimelineSemaphore();
+    computeTimeline = createTimelineSemaphore();
+    graphicsTimelineValue = 0;
+    uploadTimelineValue = 0;
+    computeTimelineValue = 0;
+}
+
+VkSemaphore VkBase::createTimelineSemaphore() {
+    VkSemaphoreTypeCreateInfo typeInfo = {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    VkSemaphore semaphore;
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+        throw std::runtime_error("failed to create timeline semaphore!");
+
+    return semaphore;
+}
+
+// block CPU until GPU progress reaches exactly the specified point of the timeline
+void VkBase::waitTimelineSemaphore(VkSemaphore semaphore, uint64_t value) {
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &semaphore;
+    waitInfo.pValues = &value;
+
+    if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+        throw std::runtime_error("failed to wait for timeline semaphore!");
+}
+
 void VkBase::createCommandPool() {
     VkCommandPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-    poolInfo.flags = 0;
+    // allow re-recording of individual command buffer after swapchain recreation
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
     if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
+
+    if (isAsyncCompute) {
+        poolInfo.queueFamilyIndex = queueFamilyIndices.computeFamily.value();
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &computeCommandPool) != VK_SUCCESS)
+            throw std::runtime_error("failed to create compute command pool!");
+    }
 }
 
-void VkBase::createTextureImage() {
-    int texWidth;
-    int texHeight;
-    int texChannels;
-    stbi_uc* pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+void VkBase::createTextureImages() {
+    const std::vector<TextureData>& textureData = resourceManager.getTextures();
+    textures.resize(textureData.size());
+
+    for (size_t i=0; i<textureData.size(); ++i) {
+        createTextureImage(textureData[i], textures[i]);
+        textures[i].view = createImageView(textures[i].image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, textures[i].mipLevels);
+    }
+}
 
-    if (!pixels)
-        throw std::runtime_error("failed to load texture image!");
+void VkBase::createTextureImage(const TextureData& source, Texture& texture, bool isStreamed) {
+    const int texWidth = source.width;
+    const int texHeight = source.height;
+    const unsigned char* pixels = source.pixels;
 
-    mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+    const uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
     VkDeviceSize imageSize = texWidth * texHeight * 4;
 
+    // check if image format supports linear blitting
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+        throw std::runtime_error("texture image format does not support linear blitting!");
+
+    // textures can do with a fallback, so they are refused over memory budget; allocated before staging so that costs nothing
+    if (!createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTag::Texture, texture.image, texture.memory, isStreamed)) {
+        std::cerr << "Texture " << texWidth << "x" << texHeight << " is over device memory budget, using fallback\n";
+        unsigned char fallbackPixel[4] = {128, 128, 128, 255};
+        TextureData fallback;
+        fallback.pixels = fallbackPixel;
+        fallback.width = 1;
+        fallback.height = 1;
+        createTextureImage(fallback, texture, false);
+        return;
+    }
+    texture.mipLevels = mipLevels;
+
     VkBuffer stagingBuffer;
     VkDeviceMemory stagingBufferMemory;
 
     if (isNeedStagingBuffer) {
-        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTag::Staging, stagingBuffer, stagingBufferMemory);
 
         void* data;
         vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
@@ -372,7 +898,7 @@ void VkBase::createTextureImage() {
         vkUnmapMemory(device, stagingBufferMemory);
     }
     else {
-        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTag::Staging, stagingBuffer, stagingBufferMemory);
 
         void* data;
         vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
@@ -380,23 +906,36 @@ void VkBase::createTextureImage() {
         vkUnmapMemory(device, stagingBufferMemory);
     }
 
-    stbi_image_free(pixels);
+    // layout transitions, and barriers between upload, and mipmap generation are derived by the graph
+    RenderGraph graph(device, physicalDevice, &memoryTracker);
+    RenderGraph::ResourceHandle staging = graph.importBuffer("staging", stagingBuffer, RenderGraph::Usage::None);
+    RenderGraph::ResourceHandle textureHandle = graph.importImage("texture", texture.image, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels, RenderGraph::Usage::None);
 
-    createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
-    transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-    copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+    RenderGraph::PassHandle uploadPass = graph.addPass("upload texture", [&](VkCommandBuffer commandBuffer) {
+        copyBufferToImage(commandBuffer, stagingBuffer, texture.image, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+    });
+    graph.read(uploadPass, staging, RenderGraph::Usage::TransferSrc);
+    graph.write(uploadPass, textureHandle, RenderGraph::Usage::TransferDst);
 
-    // if enable generating mipmap, comment transitionImageLayout() line, otherwise
-    // comment another line
-    //transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels);
-    generateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
+    // barriers between mip levels are internal to the pass, every level ends up as transfer source
+    RenderGraph::PassHandle mipmapPass = graph.addPass("generate mipmaps", [&](VkCommandBuffer commandBuffer) {
+        generateMipmaps(commandBuffer, texture.image, texWidth, texHeight, mipLevels);
+    });
+    graph.write(mipmapPass, textureHandle, RenderGraph::Usage::TransferDst);
+    graph.setExitUsage(mipmapPass, textureHandle, RenderGraph::Usage::TransferSrc);
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-}
+    graph.setFinalUsage(textureHandle, RenderGraph::Usage::FragmentShaderRead);
+    graph.compile();
+
+    VkCommandBuffer commandBuffer = beginUploadCommands();
+    graph.execute(commandBuffer);
+    endUploadCommands(commandBuffer);
+
+#ifndef NDEBUG
+    graph.printStats("texture upload");
+#endif
 
-void VkBase::createTextureImageView() {
-    textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+    releaseStagingBuffer(stagingBuffer, stagingBufferMemory);
 }
 
 void VkBase::createTextureSampler() {
@@ -416,41 +955,231 @@ void VkBase::createTextureSampler() {
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = static_cast<float>(mipLevels);
+    // shared by all textures, so don't clamp to mip count of any particular one
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
     if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
         throw std::runtime_error("failed to create texture sampler!");
 }
 
-void VkBase::createVertexBuffer() {
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+// upload every mesh into its own ranges of geometry arena, all copies share one staging buffer
+void VkBase::createGeometryBuffer() {
+    const std::vector<Vertex>& vertices = resourceManager.getVertices();
+    const std::vector<uint32_t>& indices = resourceManager.getIndices();
+    const std::vector<ResourceManager::Mesh>& meshes = resourceManager.getMeshes();
+
+    // alignment slack for each range, plus headroom for meshes streamed in later
+    VkDeviceSize requiredSize = 0;
+    for (const ResourceManager::Mesh& mesh : meshes)
+        requiredSize += mesh.vertexCount * sizeof(Vertex) + mesh.indexCount * sizeof(uint32_t) + sizeof(Vertex) + sizeof(uint32_t);
+    const VkDeviceSize capacity = static_cast<VkDeviceSize>(requiredSize * GEOMETRY_ARENA_HEADROOM);
+
+    const VkMemoryPropertyFlags arenaProperties = isNeedStagingBuffer ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    geometryArena.init(device, physicalDevice, capacity, arenaProperties, &memoryTracker);
+
+    // vertex ranges are aligned to vertex stride so that vertexOffset is a whole number of vertices
+    geometryMeshes.resize(meshes.size());
+    for (size_t i=0; i<meshes.size(); ++i) {
+        geometryMeshes[i].vertices = geometryArena.allocate(meshes[i].vertexCount * sizeof(Vertex), sizeof(Vertex));
+        geometryMeshes[i].indices = geometryArena.allocate(meshes[i].indexCount * sizeof(uint32_t), sizeof(uint32_t));
+        geometryMeshes[i].indexCount = meshes[i].indexCount;
+    }
+
+    const VkDeviceSize vertexBytes = sizeof(Vertex) * vertices.size();
+    const VkDeviceSize indexBytes = sizeof(uint32_t) * indices.size();
+    const VkDeviceSize stagingSize = vertexBytes + indexBytes;
 
     if (isNeedStagingBuffer) {
         VkBuffer stagingBuffer;
         VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTag::Staging, stagingBuffer, stagingBufferMemory);
 
         void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        std::memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
+        vkMapMemory(device, stagingBufferMemory, 0, stagingSize, 0, &data);
+        std::memcpy(data, vertices.data(), static_cast<size_t>(vertexBytes));
+        std::memcpy(static_cast<char*>(data) + vertexBytes, indices.data(), static_cast<size_t>(indexBytes));
         vkUnmapMemory(device, stagingBufferMemory);
 
-        // non-mappable buffer now
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
-        copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        std::vector<VkBufferCopy> regions;
+        for (size_t i=0; i<meshes.size(); ++i) {
+            VkBufferCopy vertexRegion = {};
+            vertexRegion.srcOffset = meshes[i].vertexOffset * sizeof(Vertex);
+            vertexRegion.dstOffset = geometryArena.getOffset(geometryMeshes[i].vertices);
+            vertexRegion.size = geometryArena.getSize(geometryMeshes[i].vertices);
+            regions.push_back(vertexRegion);
+
+            VkBufferCopy indexRegion = {};
+            indexRegion.srcOffset = vertexBytes + meshes[i].firstIndex * sizeof(uint32_t);
+            indexRegion.dstOffset = geometryArena.getOffset(geometryMeshes[i].indices);
+            indexRegion.size = geometryArena.getSize(geometryMeshes[i].indices);
+            regions.push_back(indexRegion);
+        }
+
+        VkCommandBuffer commandBuffer = beginUploadCommands();
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer, geometryArena.getBuffer(), static_cast<uint32_t>(regions.size()), regions.data());
+        endUploadCommands(commandBuffer);
+
+        releaseStagingBuffer(stagingBuffer, stagingBufferMemory);
     }
     else {
-        createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertexBuffer, vertexBufferMemory);
+        void* data;
+        vkMapMemory(device, geometryArena.getMemory(), 0, capacity, 0, &data);
+        for (size_t i=0; i<meshes.size(); ++i) {
+            std::memcpy(static_cast<char*>(data) + geometryArena.getOffset(geometryMeshes[i].vertices), &vertices[meshes[i].vertexOffset], meshes[i].vertexCount * sizeof(Vertex));
+            std::memcpy(static_cast<char*>(data) + geometryArena.getOffset(geometryMeshes[i].indices), &indices[meshes[i].firstIndex], meshes[i].indexCount * sizeof(uint32_t));
+        }
+        vkUnmapMemory(device, geometryArena.getMemory());
+    }
+}
+
+// compact geometry arena, meshes move so command buffers are re-recorded afterwards
+void VkBase::defragmentGeometry() {
+    waitTimelineSemaphore(graphicsTimeline, graphicsTimelineValue);
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    GeometryArena::RetiredBuffer retired = geometryArena.defragment(commandBuffer);
+
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr);
+
+    endSingleTimeCommands(commandBuffer);
+    geometryArena.destroyRetired(retired);
+
+    recordCommandBuffers();
+}
+
+// compute pipeline doesn't depend on render pass, so it's kept across swapchain recreation
+void VkBase::createSkinningPipeline() {
+    auto compShaderCode = shaderLibrary.load("skin.spv");
+    skinningShaderReflection.addModule(compShaderCode);
+
+    // bind pose, influences, bone palette, skinned vertices as in shaders/skin.comp
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = skinningShaderReflection.getSetBindings(0);
+    const std::vector<VkPushConstantRange> pushConstantRanges = skinningShaderReflection.getPushConstantRanges();
+    if (bindings.size() != 4 || pushConstantRanges.size() != 1 || pushConstantRanges[0].size < sizeof(SkinningPushConstants))
+        throw std::runtime_error("failed to match skinning shader bindings, and push constants!");
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    skinningDescriptorSetLayout = descriptorLayoutCache.createDescriptorLayout(&layoutInfo);
+
+    // per-mesh ranges
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &skinningDescriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &skinningPipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create skinning pipeline layout!");
+
+    skinningPipeline = createSkinningComputePipeline(compShaderCode);
+}
+
+VkPipeline VkBase::createSkinningComputePipeline(const std::vector<char>& code) const {
+    VkShaderModule compShaderModule = createShaderModule(code);
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = compShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = skinningPipelineLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    const VkResult result = vkCreateComputePipelines(device, pipelineCompiler.getCache(), 1, &pipelineInfo, nullptr, &pipeline);
+    vkDestroyShaderModule(device, compShaderModule, nullptr);
+    if (result != VK_SUCCESS)
+        throw std::runtime_error("failed to create skinning pipeline!");
+    return pipeline;
+}
+
+// bind pose, and influences never change, both are packed the same as vertices of resource manager
+void VkBase::createSkinningBuffers() {
+    const std::vector<Vertex>& vertices = resourceManager.getVertices();
+    skinInfluences.resize(vertices.size());
+    for (const ResourceManager::Mesh& mesh : resourceManager.getMeshes())
+        buildSkinInfluences(&vertices[mesh.vertexOffset], mesh.vertexCount, &skinInfluences[mesh.vertexOffset]);
+
+    createDeviceBuffer(vertices.data(), sizeof(Vertex) * vertices.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryTag::Skinning, skinSourceBuffer, skinSourceBufferMemory, true);
+    createDeviceBuffer(skinInfluences.data(), sizeof(SkinInfluence) * skinInfluences.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryTag::Skinning, skinInfluenceBuffer, skinInfluenceBufferMemory, true);
+}
+
+// palette is written by CPU, and skinned vertices by compute every frame, so there's one of each per swapchain's image
+void VkBase::createSkinningOutputs() {
+    const size_t numImages = swapChainImages.size();
+    skinPaletteBuffers.resize(numImages);
+    skinPaletteBuffersMemory.resize(numImages);
+    skinnedVertexBuffers.resize(numImages);
+    skinnedVertexBuffersMemory.resize(numImages);
+    skinPalettes.assign(numImages, computeBonePalette(0.0f));
+
+    for (size_t i=0; i<numImages; ++i) {
+        createBuffer(sizeof(BonePalette), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTag::Uniform, skinPaletteBuffers[i], skinPaletteBuffersMemory[i], true);
+        // transfer source for verification readback
+        createBuffer(geometryArena.getCapacity(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTag::Skinning, skinnedVertexBuffers[i], skinnedVertexBuffersMemory[i], true);
+    }
+}
 
-        void * data;
-        vkMapMemory(device, vertexBufferMemory, 0, bufferSize, 0, &data);
-        std::memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-        vkUnmapMemory(device, vertexBufferMemory);
+void VkBase::updateSkinningPalette(uint32_t currentImage, float time) {
+    skinPalettes[currentImage] = computeBonePalette(time);
+
+    void* data;
+    vkMapMemory(device, skinPaletteBuffersMemory[currentImage], 0, sizeof(BonePalette), 0, &data);
+    std::memcpy(data, &skinPalettes[currentImage], sizeof(BonePalette));
+    vkUnmapMemory(device, skinPaletteBuffersMemory[currentImage]);
+}
+
+// one dispatch per mesh (shared by all its instances), output goes to the mesh's offset within geometry arena
+void VkBase::recordSkinningPass(VkCommandBuffer commandBuffer, size_t imageIndex) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, skinningPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, skinningPipelineLayout, 0, 1, &skinningDescriptorSets[imageIndex], 0, nullptr);
+
+    const std::vector<ResourceManager::Mesh>& meshes = resourceManager.getMeshes();
+    for (size_t m=0; m<meshes.size(); ++m) {
+        SkinningPushConstants pushConstants = {};
+        pushConstants.sourceFirstVertex = static_cast<uint32_t>(meshes[m].vertexOffset);
+        pushConstants.outputFirstVertex = static_cast<uint32_t>(geometryArena.getOffset(geometryMeshes[m].vertices) / sizeof(Vertex));
+        pushConstants.vertexCount = meshes[m].vertexCount;
+
+        vkCmdPushConstants(commandBuffer, skinningPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, (pushConstants.vertexCount + SKINNING_WORKGROUP_SIZE - 1) / SKINNING_WORKGROUP_SIZE, 1, 1);
     }
 }
 
+// deformation of this frame overlaps with graphics work of the previous one, drawFrame() makes graphics wait for it
+void VkBase::submitSkinning(uint32_t imageIndex) {
+    const uint64_t computeValue = ++computeTimelineValue;
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &computeValue;
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &computeCommandBuffers[imageIndex];
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &computeTimeline;
+
+    if (vkQueueSubmit(computeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        throw std::runtime_error("failed to submit compute command buffer!");
+}
+
 void VkBase::createCommandBuffers() {
     commandBuffers.resize(swapChainFramebuffers.size());
 
@@ -464,6 +1193,28 @@ void VkBase::createCommandBuffers() {
         throw std::runtime_error("failed to allocate command buffers!");
     }
 
+    if (isAsyncCompute) {
+        computeCommandBuffers.resize(swapChainFramebuffers.size());
+        allocInfo.commandPool = computeCommandPool;
+        if (vkAllocateCommandBuffers(device, &allocInfo, computeCommandBuffers.data()) != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate compute command buffers!");
+    }
+
+    // queries are recorded into command buffers, so there's one per swapchain's image as well
+    if (options.pipelineStatistics && isPipelineStatisticsSupported)
+        pipelineStatistics.init(device, static_cast<uint32_t>(commandBuffers.size()));
+    if (isGpuTimestampSupported) {
+        profiler.initGpu(device, timestampPeriod, static_cast<uint32_t>(commandBuffers.size()));
+    }
+
+    recordCommandBuffers();
+}
+
+void VkBase::recordCommandBuffers() {
+    isProfilerRecorded = profiler.isEnabled() && profiler.hasGpu();
+    // calibrated on first use, it idles the queue which a disabled profiler shouldn't cost
+    if (isProfilerRecorded && !profiler.isGpuClockCalibrated())
+        profiler.calibrateGpuClock(graphicsQueue, commandPool);
     for (size_t i=0; i<commandBuffers.size(); ++i) {
         VkCommandBufferBeginInfo beginInfo = {};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -473,35 +1224,165 @@ void VkBase::createCommandBuffers() {
         if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
+        if (isProfilerRecorded)
+            profiler.cmdBeginGpuFrame(commandBuffers[i], static_cast<uint32_t>(i));
+
+        // attachments are transitioned by render pass itself, graph tracks them so
+        // that any pass added before, or after the main one gets correct barriers
+        RenderGraph graph(device, physicalDevice, &memoryTracker);
+        RenderGraph::ResourceHandle swapChainImage = graph.importImage("swapchain", swapChainImages[i], VK_IMAGE_ASPECT_COLOR_BIT, 1, RenderGraph::Usage::None);
+        const bool isMultisampled = colorImage != VK_NULL_HANDLE;
+        RenderGraph::ResourceHandle colorTarget = isMultisampled ? graph.importImage("color", colorImage, VK_IMAGE_ASPECT_COLOR_BIT, 1, RenderGraph::Usage::None) : 0;
+        // aspect follows depth format, so tracked layout matches render pass's finalLayout
+        const VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencilComponent(findDepthFormat()) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+        RenderGraph::ResourceHandle depthTarget = graph.importImage("depth", depthImage, depthAspect, 1, RenderGraph::Usage::None);
+        RenderGraph::ResourceHandle geometryHandle = graph.importBuffer("geometry", geometryArena.getBuffer(), RenderGraph::Usage::VertexBufferRead);
+        RenderGraph::ResourceHandle uniformHandle = graph.importBuffer("uniforms", uniformBuffers[i], RenderGraph::Usage::UniformBufferRead);
+
+        // with async compute, graphics submission waits for deformation on a semaphore instead of a barrier
+        RenderGraph::ResourceHandle skinnedHandle = 0;
+        if (options.deformation) {
+            skinnedHandle = graph.importBuffer("skinned vertices", skinnedVertexBuffers[i], RenderGraph::Usage::VertexBufferRead);
+            if (!isAsyncCompute) {
+                RenderGraph::PassHandle skinningPass = graph.addPass("skinning", [&](VkCommandBuffer commandBuffer) {
+                    recordSkinningPass(commandBuffer, i);
+                });
+                graph.write(skinningPass, skinnedHandle, RenderGraph::Usage::ComputeShaderWrite);
+            }
+        }
 
-        VkRenderPassBeginInfo renderPassInfo = {};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderPass;
-        renderPassInfo.framebuffer = swapChainFramebuffers[i];
-        renderPassInfo.renderArea.offset = {0,0};
-        renderPassInfo.renderArea.extent = swapChainExtent;
+        RenderGraph::PassHandle mainPass = graph.addPass("main", [&](VkCommandBuffer commandBuffer) {
+            recordMainPass(commandBuffer, i);
+        });
+        if (isMultisampled)
+            graph.attachment(mainPass, colorTarget, RenderGraph::Usage::ColorAttachmentWrite, RenderGraph::Usage::ColorAttachmentWrite);
+        graph.attachment(mainPass, depthTarget, RenderGraph::Usage::DepthAttachmentWrite, RenderGraph::Usage::DepthAttachmentWrite);
+        graph.attachment(mainPass, swapChainImage, RenderGraph::Usage::ColorAttachmentWrite, RenderGraph::Usage::Present);
+        for (const Texture& texture : textures) {
+            RenderGraph::ResourceHandle textureHandle = graph.importImage("texture", texture.image, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels, RenderGraph::Usage::FragmentShaderRead);
+            graph.read(mainPass, textureHandle, RenderGraph::Usage::FragmentShaderRead);
+        }
+        graph.read(mainPass, geometryHandle, RenderGraph::Usage::VertexBufferRead);
+        graph.read(mainPass, geometryHandle, RenderGraph::Usage::IndexBufferRead);
+        graph.read(mainPass, uniformHandle, RenderGraph::Usage::UniformBufferRead);
+        if (options.deformation)
+            graph.read(mainPass, skinnedHandle, RenderGraph::Usage::VertexBufferRead);
+
+        // render pass leaves it ready for present, copy it out from there
+        if (i < readbackBuffers.size()) {
+            RenderGraph::ResourceHandle readbackHandle = graph.importBuffer("readback", readbackBuffers[i], RenderGraph::Usage::None);
+            RenderGraph::PassHandle readbackPass = graph.addPass("readback", [&](VkCommandBuffer commandBuffer) {
+                VkBufferImageCopy region = {};
+                region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.layerCount = 1;
+                region.imageExtent = { swapChainExtent.width, swapChainExtent.height, 1 };
+                vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[i], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffers[i], 1, &region);
+            });
+            graph.read(readbackPass, swapChainImage, RenderGraph::Usage::TransferSrc);
+            graph.write(readbackPass, readbackHandle, RenderGraph::Usage::TransferDst);
+            graph.setFinalUsage(readbackHandle, RenderGraph::Usage::HostRead);
+        }
 
-        std::array<VkClearValue, 2> clearValues = {};
-        clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
-        clearValues[1].depthStencil = {1.0f, 0};
+        graph.setFinalUsage(swapChainImage, RenderGraph::Usage::Present);
+        graph.compile();
+        graph.execute(commandBuffers[i]);
 
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassInfo.pClearValues = clearValues.data();
+        if (isProfilerRecorded)
+            profiler.cmdEndGpuFrame(commandBuffers[i], static_cast<uint32_t>(i));
+        if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
 
-        vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        if (isAsyncCompute) {
+            if (vkBeginCommandBuffer(computeCommandBuffers[i], &beginInfo) != VK_SUCCESS)
+                throw std::runtime_error("failed to begin recording compute command buffer!");
+            recordSkinningPass(computeCommandBuffers[i], i);
+            if (vkEndCommandBuffer(computeCommandBuffers[i]) != VK_SUCCESS)
+                throw std::runtime_error("failed to record compute command buffer!");
+        }
+    }
+}
 
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-        vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
-        vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
-        vkCmdEndRenderPass(commandBuffers[i]);
+void VkBase::recordMainPass(VkCommandBuffer commandBuffer, size_t imageIndex) {
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+    renderPassInfo.renderArea.offset = {0,0};
+    renderPassInfo.renderArea.extent = swapChainExtent;
 
-        if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record command buffer!");
+    std::array<VkClearValue, 2> clearValues = {};
+    clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
+    clearValues[1].depthStencil = {1.0f, 0};
+
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    const uint32_t query = static_cast<uint32_t>(imageIndex);
+    const bool isQueried = pipelineStatistics.isEnabled() && pipelineStatistics.hasQuery(query);
+    if (isQueried)
+        pipelineStatistics.cmdReset(commandBuffer, query);
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    if (isQueried)
+        pipelineStatistics.cmdBegin(commandBuffer, query);
+
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(swapChainExtent.width);
+    viewport.height = static_cast<float>(swapChainExtent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.offset = {0, 0};
+    scissor.extent = swapChainExtent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    // bound once, meshes are addressed by offsets, deformed vertices are at the same offsets as in geometry arena
+    VkBuffer vertexBuffers[] = {options.deformation ? skinnedVertexBuffers[imageIndex] : geometryArena.getBuffer()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, geometryArena.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+    // both draws are in the same subpass, rasterization order makes depth written by the first visible to the second
+    if (isDepthPrepassEnabled) {
+        recordDrawInstances(commandBuffer, imageIndex, DrawPass::DepthPrepass);
+        recordDrawInstances(commandBuffer, imageIndex, DrawPass::DepthEqual);
+    }
+    else
+        recordDrawInstances(commandBuffer, imageIndex, DrawPass::Shade);
+
+    if (isQueried)
+        pipelineStatistics.cmdEnd(commandBuffer, query);
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+void VkBase::recordDrawInstances(VkCommandBuffer commandBuffer, size_t imageIndex, DrawPass pass) {
+    // instances are sorted by material, so descriptor set, and pipeline only change between material groups
+    const std::vector<ResourceManager::Material>& materials = resourceManager.getMaterials();
+    const size_t numMaterials = materials.size();
+    uint32_t boundMaterial = UINT32_MAX;
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    for (const ResourceManager::Instance& instance : resourceManager.getInstances()) {
+        if (instance.material != boundMaterial) {
+            const ShaderVariantCache::Pipelines& pipelines = pipelineVariants.get(materials[instance.material].variant);
+            VkPipeline pipeline = pass == DrawPass::DepthPrepass ? pipelines.depthPrepass : (pass == DrawPass::DepthEqual ? pipelines.depthEqual : pipelines.shade);
+            if (pipeline != boundPipeline) {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                boundPipeline = pipeline;
+            }
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[imageIndex * numMaterials + instance.material], 0, nullptr);
+            boundMaterial = instance.material;
         }
+
+        const GeometryMesh& mesh = geometryMeshes[instance.mesh];
+        const uint32_t firstIndex = static_cast<uint32_t>(geometryArena.getOffset(mesh.indices) / sizeof(uint32_t));
+        const int32_t vertexOffset = static_cast<int32_t>(geometryArena.getOffset(mesh.vertices) / sizeof(Vertex));
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(instance.transform), &instance.transform);
+        vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, firstIndex, vertexOffset, 0);
     }
 }
 
@@ -511,11 +1392,13 @@ void VkBase::createFramebuffers() {
     for (size_t i=0; i<swapChainImageViews.size(); ++i) {
         // order is important here, specify first attachment that pixels will be written to
         std::array<VkImageView, 3> attachments = {colorImageView, depthImageView, swapChainImageViews[i]};
+        if (msaaSamples == VK_SAMPLE_COUNT_1_BIT)
+            attachments = {swapChainImageViews[i], depthImageView, VK_NULL_HANDLE};
         
         VkFramebufferCreateInfo framebufferInfo = {};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferInfo.renderPass = renderPass;
-        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.attachmentCount = msaaSamples == VK_SAMPLE_COUNT_1_BIT ? 2 : static_cast<uint32_t>(attachments.size());
         framebufferInfo.pAttachments = attachments.data();
         framebufferInfo.width = swapChainExtent.width;
         framebufferInfo.height = swapChainExtent.height;
@@ -532,12 +1415,19 @@ void VkBase::createRenderPass() {
     colorAttachment.format = swapChainImageFormat;
     colorAttachment.samples = msaaSamples;
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;     // only resolved result is kept
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    // without multisampling, render directly to swapchain's image, resolve requires more than one sample
+    const bool isMultisampled = msaaSamples > VK_SAMPLE_COUNT_1_BIT;
+    if (!isMultisampled) {
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    }
+
     VkAttachmentDescription depthAttachment = {};
     depthAttachment.format = findDepthFormat();
     depthAttachment.samples = msaaSamples;
@@ -584,21 +1474,23 @@ void VkBase::createRenderPass() {
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
     subpass.pDepthStencilAttachment = &depthAttachmentRef;
-    subpass.pResolveAttachments = &colorAttachmentResolveRef;
+    subpass.pResolveAttachments = isMultisampled ? &colorAttachmentResolveRef : nullptr;
 
     VkSubpassDependency dependency = {};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    // depth is cleared from undefined layout every frame (no explicit transition), so it
+    // has to wait for depth tests of the previous frame as well
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
     // create renderpass
     std::array<VkAttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
     VkRenderPassCreateInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.attachmentCount = isMultisampled ? static_cast<uint32_t>(attachments.size()) : 2;
     renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
@@ -608,6 +1500,10 @@ void VkBase::createRenderPass() {
     if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass!");
     }
+
+    // remember what render pass (and thus pipeline) was built against, see isRenderPassCompatible()
+    renderPassImageFormat = swapChainImageFormat;
+    renderPassSampleCount = msaaSamples;
 }
 
 VkShaderModule VkBase::createShaderModule(const std::vector<char>& code) const {
@@ -624,50 +1520,103 @@ VkShaderModule VkBase::createShaderModule(const std::vector<char>& code) const {
     return shaderModule;
 }
 
+// reflected once, layouts, and vertex input follow the shaders instead of being mirrored by hand
+void VkBase::reflectShaders() {
+    shaderReflection.addModule(shaderLibrary.load("vert.spv"));
+    shaderReflection.addModule(shaderLibrary.load("frag.spv"));
+
+    // what the CPU side writes has to cover what shaders read, attribute offsets are then taken from Vertex
+    const auto vertexAttributeDescriptions = Vertex::getAttributeDescriptions();
+    for (const VkVertexInputAttributeDescription& input : shaderReflection.getVertexInputs()) {
+        auto it = std::find_if(vertexAttributeDescriptions.begin(), vertexAttributeDescriptions.end(), [&](const VkVertexInputAttributeDescription& attribute) {
+            return attribute.location == input.location;
+        });
+        if (it == vertexAttributeDescriptions.end() || it->format != input.format)
+            throw std::runtime_error("failed to match vertex shader input at location " + std::to_string(input.location) + " with Vertex!");
+    }
+    if (shaderReflection.getNumSets() != 1 || shaderReflection.getBufferSize(0, 0) > sizeof(UniformBufferObject))
+        throw std::runtime_error("failed to match shader descriptor sets with uniform buffer, and texture!");
+    const std::vector<VkPushConstantRange> pushConstantRanges = shaderReflection.getPushConstantRanges();
+    if (pushConstantRanges.size() != 1 || pushConstantRanges[0].stageFlags != VK_SHADER_STAGE_VERTEX_BIT || pushConstantRanges[0].size < sizeof(glm::mat4))
+        throw std::runtime_error("failed to match shader push constants with per-instance transform!");
+}
+
 void VkBase::createDescriptorSetLayout() {
-    VkDescriptorSetLayoutBinding uboLayoutBinding = {};
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    uboLayoutBinding.pImmutableSamplers = nullptr;
-
-    VkDescriptorSetLayoutBinding samplerLayoutBinding = {};
-    samplerLayoutBinding.binding = 1;
-    samplerLayoutBinding.descriptorCount = 1;
-    samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLayoutBinding.pImmutableSamplers = nullptr;
-    samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = shaderReflection.getSetBindings(0);
 
     VkDescriptorSetLayoutCreateInfo layoutInfo = {};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
     layoutInfo.pBindings = bindings.data();
 
-    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
-        throw std::runtime_error("failed to create descriptor set layout!");
+    // layout is owned by the cache
+    descriptorSetLayout = descriptorLayoutCache.createDescriptorLayout(&layoutInfo);
+}
+
+// a few threads are enough, variants are compiled once per material feature combination
+void VkBase::createPipelineCompiler() {
+    const uint32_t numThreads = options.asyncPipelines ? std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2)) : 0;
+    pipelineCompiler.init(device, physicalDevice, numThreads, options.pipelineCachePath);
+#ifndef NDEBUG
+    std::cout << "Pipeline compiler: " << numThreads << " thread(s), cache " << (pipelineCompiler.isCacheLoaded() ? "loaded from " + options.pipelineCachePath : std::string("cold")) << '\n';
+#endif
 }
 
 void VkBase::createGraphicsPipeline() {
-    auto vertShaderCode = readFile("shaders/vert.spv");
-    auto fragShaderCode = readFile("shaders/frag.spv");
+    auto vertShaderCode = shaderLibrary.load("vert.spv");
+    auto fragShaderCode = shaderLibrary.load("frag.spv");
 
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+    vertShaderModule = createShaderModule(vertShaderCode);
+    fragShaderModule = createShaderModule(fragShaderCode);
+
+    // per-instance transform
+    const std::vector<VkPushConstantRange> pushConstantRanges = shaderReflection.getPushConstantRanges();
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    // pipelines themselves depend on material, they are created when first recorded, on compiler's threads
+    pipelineVariants.init(device, getVariantCreator(vertShaderModule, fragShaderModule), &pipelineCompiler);
+
+    // default material is drawable right away, variants of scene's materials start compiling
+    // while assets load, and are uploaded
+    pipelineVariants.setFallback(ShaderVariant());
+    for (const ResourceManager::Material& material : resourceManager.getMaterials())
+        pipelineVariants.prepare(material.variant);
+}
+
+// shader modules, and sample settings are captured as they may change on main thread while a variant is compiling
+ShaderVariantCache::Creator VkBase::getVariantCreator(VkShaderModule vertModule, VkShaderModule fragModule) {
+    const VkSampleCountFlagBits samples = msaaSamples;
+    const bool isSampleShaded = isSampleShadingEnabled;
+    return [this, vertModule, fragModule, samples, isSampleShaded](const ShaderVariant& variant, const VkSpecializationInfo& specializationInfo) {
+        return createVariantPipelines(variant, specializationInfo, vertModule, fragModule, samples, isSampleShaded);
+    };
+}
+
+ShaderVariantCache::Pipelines VkBase::createVariantPipelines(const ShaderVariant& variant, const VkSpecializationInfo& specializationInfo, VkShaderModule vertModule, VkShaderModule fragModule, VkSampleCountFlagBits samples, bool isSampleShaded) {
+    ProfileZone zone(profiler, "create variant pipelines");
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.module = vertModule;
     vertShaderStageInfo.pName = "main";
 
     VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
     fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.module = fragModule;
     fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
@@ -690,24 +1639,13 @@ void VkBase::createGraphicsPipeline() {
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
     // - Viewport and Scissors
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapChainExtent.width);
-    viewport.height = static_cast<float>(swapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor = {};
-    scissor.offset = {0, 0};
-    scissor.extent = swapChainExtent;
-
+    // both are dynamic states set at command recording time, so pipeline doesn't depend on swapchain's extent
     VkPipelineViewportStateCreateInfo viewportState = {};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
+    viewportState.pViewports = nullptr;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    viewportState.pScissors = nullptr;
 
     // - Rasterizers
     VkPipelineRasterizationStateCreateInfo rasterizer = {};
@@ -726,8 +1664,8 @@ void VkBase::createGraphicsPipeline() {
     // - Multisampling
     VkPipelineMultisampleStateCreateInfo multisampling = {};
     multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_TRUE;
-    multisampling.rasterizationSamples = msaaSamples;
+    multisampling.sampleShadingEnable = isSampleShaded ? VK_TRUE : VK_FALSE;
+    multisampling.rasterizationSamples = samples;
     multisampling.minSampleShading = 0.2f;
     multisampling.pSampleMask = nullptr;
     multisampling.alphaToCoverageEnable = VK_FALSE;
@@ -771,26 +1709,14 @@ void VkBase::createGraphicsPipeline() {
     // configure dynamic states to avoid re-creation of pipeline but we need to specify runtime data at drawing time
     VkDynamicState dynamicStates[] = {
         VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_LINE_WIDTH
+        VK_DYNAMIC_STATE_SCISSOR
     };
 
-    // isn't used at the moment
     VkPipelineDynamicStateCreateInfo dynamicState = {};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = 1;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(sizeof(dynamicStates) / sizeof(dynamicStates[0]));
     dynamicState.pDynamicStates = dynamicStates;
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout!");
-    }
-
     VkGraphicsPipelineCreateInfo pipelineInfo = {};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineInfo.stageCount = 2;
@@ -802,19 +1728,39 @@ void VkBase::createGraphicsPipeline() {
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = pipelineLayout;
     pipelineInfo.renderPass = renderPass;
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+    ShaderVariantCache::Pipelines pipelines;
+    if (vkCreateGraphicsPipelines(device, pipelineCompiler.getCache(), 1, &pipelineInfo, nullptr, &pipelines.shade) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
 
-    vkDestroyShaderModule(device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    // depth pre-pass shares vertex stage so depth values match exactly (see invariant gl_Position in main.vert),
+    // without fragment shader there is nothing to run per sample, alpha tested variants need it to discard though,
+    // and per sample as in shading pass so coverage of both passes matches
+    pipelineInfo.stageCount = variant.isAlphaTested() ? 2 : 1;
+    multisampling.sampleShadingEnable = (variant.isAlphaTested() && isSampleShaded) ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.colorWriteMask = 0;
+
+    if (vkCreateGraphicsPipelines(device, pipelineCompiler.getCache(), 1, &pipelineInfo, nullptr, &pipelines.depthPrepass) != VK_SUCCESS)
+        throw std::runtime_error("failed to create depth pre-pass pipeline!");
+
+    // then only the front-most fragment of each sample passes, depth is already final
+    pipelineInfo.stageCount = 2;
+    multisampling.sampleShadingEnable = isSampleShaded ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_EQUAL;
+    depthStencil.depthWriteEnable = VK_FALSE;
+
+    if (vkCreateGraphicsPipelines(device, pipelineCompiler.getCache(), 1, &pipelineInfo, nullptr, &pipelines.depthEqual) != VK_SUCCESS)
+        throw std::runtime_error("failed to create depth equal pipeline!");
+
+    return pipelines;
 }
 
 void VkBase::createImageViews() {
@@ -831,7 +1777,7 @@ void VkBase::createSwapChain() {
     VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-    uint32_t imageCount = 3;
+    uint32_t imageCount = std::max(options.swapChainImageCount, swapChainSupport.capabilities.minImageCount);
     if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
         imageCount = swapChainSupport.capabilities.maxImageCount;
     }
@@ -845,6 +1791,9 @@ void VkBase::createSwapChain() {
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // golden image check copies rendered image out
+    if (!options.goldenPath.empty() && (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT))
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
     uint32_t indices[] = { queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.presentFamily.value() };
 
@@ -864,12 +1813,20 @@ void VkBase::createSwapChain() {
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    // hand over the current swapchain (if any) so presentation engine can reuse its resources
+    VkSwapchainKHR oldSwapChain = swapChain;
+    createInfo.oldSwapchain = oldSwapChain;
 
     if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
         throw std::runtime_error("failed to create swap chain!");
     }
 
+    // old swapchain is retired now, frames rendering to it have been waited on but presentation of its images
+    // may still be pending, so it's destroyed once the new one hands out an image (one retired before that goes now)
+    if (retiredSwapChain != VK_NULL_HANDLE)
+        vkDestroySwapchainKHR(device, retiredSwapChain, nullptr);
+    retiredSwapChain = oldSwapChain;
+
     // populate swapchain's images
     vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
     swapChainImages.resize(imageCount);
@@ -878,9 +1835,23 @@ void VkBase::createSwapChain() {
     // cache essential values for later use
     swapChainImageFormat = surfaceFormat.format;
     swapChainExtent = extent;
+    swapChainPresentMode = presentMode;
+
+#ifndef NDEBUG
+    std::cout << "Swapchain: " << imageCount << " images, present mode " << getPresentModeString(presentMode) << '\n';
+#endif
 }
 
 void VkBase::createSurface() {
+    if (options.headless) {
+        auto func = (PFN_vkCreateHeadlessSurfaceEXT)vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT");
+        VkHeadlessSurfaceCreateInfoEXT createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+        if (func == nullptr || func(instance, &createInfo, nullptr, &surface) != VK_SUCCESS)
+            throw std::runtime_error("failed to create headless surface!");
+        return;
+    }
+
     if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
         throw std::runtime_error("failed to create window surface!");
     }
@@ -905,15 +1876,21 @@ VkBase::QueueFamilyIndices VkBase::findQueueFamilies(VkPhysicalDevice device) co
 
     int i = 0;
     for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
-            indices.graphicsFamily = i;
+        if (!indices.isComplete()) {
+            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+                indices.graphicsFamily = i;
+
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            if (presentSupport)
+                indices.presentFamily = i;
+        }
 
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-        if (presentSupport)
-            indices.presentFamily = i;
-        
-        if (indices.isComplete())
+        // dedicated compute family usually maps to hardware queue running alongside graphics
+        if (!indices.computeFamily.has_value() && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+            indices.computeFamily = i;
+
+        if (indices.isComplete() && indices.computeFamily.has_value())
             break;
 
         ++i;
@@ -947,35 +1924,31 @@ VkBase::SwapChainSupportDetails VkBase::querySwapChainSupport(VkPhysicalDevice d
 }
 
 void VkBase::pickPhysicalDevice() {
-    uint32_t deviceCount = 0;
-    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
-    if (deviceCount == 0)
+    DeviceSelector selector;
+    enumerateDevices(selector);
+    if (selector.getCandidates().empty())
         throw std::runtime_error("failed to find GPUs with Vulkan support!");
 
-    std::vector<VkPhysicalDevice> devices(deviceCount);
-    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
-
-    // device scores
-    typedef int DeviceScore;
-    typedef bool DeviceIsDiscreteGPU;
-    std::priority_queue<std::tuple<VkPhysicalDevice, DeviceScore, DeviceIsDiscreteGPU>> pq;
-
-    for (int i=0; i<devices.size(); ++i) {
-        bool isDiscrete;
-        int score = rateDevice(devices[i], isDiscrete);
-        if (score > 0)
-            pq.push(std::make_tuple(devices[i], score, isDiscrete));
+    const std::string deviceOverride = getDeviceOverride();
+    const DeviceSelector::Candidate* selected = selector.select(deviceOverride);
+    if (selected == nullptr && !deviceOverride.empty()) {
+        std::cerr << "Device \"" << deviceOverride << "\" matches no suitable device\n";
+        selector.print(nullptr);
+        throw std::runtime_error("failed to find a suitable GPU matching requested device!");
     }
-
-    if (pq.size() > 0) 
-        // custom selection of GPU can be added here
-        physicalDevice = std::get<0>(pq.top());
-
-    if (physicalDevice == VK_NULL_HANDLE)
+    if (selected == nullptr)
         throw std::runtime_error("failed to find a suitable GPU with vulkan support!");
+    physicalDevice = selected->device;
+#ifndef NDEBUG
+    selector.print(selected);
+#endif
 
-    // set msaa samples
-    msaaSamples = getMaxUsableSampleCount();
+    // set msaa samples, requested count is a power of two so clamping keeps it a valid count
+    maxMsaaSamples = getMaxUsableSampleCount();
+    msaaSamples = options.msaaSamples > 0 ? static_cast<VkSampleCountFlagBits>(std::min<uint32_t>(options.msaaSamples, maxMsaaSamples)) : maxMsaaSamples;
+    isSampleShadingEnabled = options.sampleShading;
+    // governor never goes above what's configured
+    qualityGovernor.init(msaaSamples, isSampleShadingEnabled, options.frameBudgetMs);
 #ifndef NDEBUG
     std::cout << "MSAA Samples: " << msaaSamples << "\n";
 #endif
@@ -997,6 +1970,11 @@ void VkBase::createLogicalDevice() {
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.presentFamily.value()};
 
+    // without a separate compute family, deformation is recorded into graphics command buffers
+    isAsyncCompute = options.deformation && options.asyncCompute && queueFamilyIndices.computeFamily.has_value();
+    if (isAsyncCompute)
+        uniqueQueueFamilies.insert(queueFamilyIndices.computeFamily.value());
+
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo = {};
@@ -1016,6 +1994,11 @@ void VkBase::createLogicalDevice() {
     VkPhysicalDeviceSeparateDepthStencilLayoutsFeatures queriedSeparateDepthStencilFeature = {};
     queriedSeparateDepthStencilFeature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SEPARATE_DEPTH_STENCIL_LAYOUTS_FEATURES;
 
+    // timeline semaphores are core in Vulkan 1.2 but still an optional feature to enable
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeature = {};
+    timelineSemaphoreFeature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    queriedSeparateDepthStencilFeature.pNext = &timelineSemaphoreFeature;
+
     VkPhysicalDeviceFeatures2 queriedDeviceFeatures2 = {};
     queriedDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
     queriedDeviceFeatures2.pNext = &queriedSeparateDepthStencilFeature;
@@ -1028,6 +2011,25 @@ void VkBase::createLogicalDevice() {
     queriedSeparateDepthStencilFeature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SEPARATE_DEPTH_STENCIL_LAYOUTS_FEATURES;
     queriedSeparateDepthStencilFeature.separateDepthStencilLayouts = VK_TRUE;
 
+    if (!timelineSemaphoreFeature.timelineSemaphore)
+        throw std::runtime_error("timeline semaphores are not supported!");
+
+    // optional, only used for measurements
+    isPipelineStatisticsSupported = queriedDeviceFeatures2.features.pipelineStatisticsQuery == VK_TRUE;
+    if (options.pipelineStatistics && !isPipelineStatisticsSupported)
+        std::cerr << "Pipeline statistics queries are not supported, statistics are disabled\n";
+
+    // optional, GPU ranges of profiler
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    isGpuTimestampSupported = queueFamilies[queueFamilyIndices.graphicsFamily.value()].timestampValidBits > 0 && deviceProperties.limits.timestampPeriod > 0.0f;
+    timestampPeriod = deviceProperties.limits.timestampPeriod;
+    deviceFeatures.pipelineStatisticsQuery = queriedDeviceFeatures2.features.pipelineStatisticsQuery;
+
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     // enable separate depth/stencil layouts especially for this program as we only use depth buffer.
@@ -1035,8 +2037,22 @@ void VkBase::createLogicalDevice() {
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    // optional, heap usage, and budget for memory tracker
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    bool isMemoryBudgetSupported = false;
+    for (const VkExtensionProperties& extension : availableExtensions) {
+        if (std::strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+            isMemoryBudgetSupported = true;
+    }
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+    if (isMemoryBudgetSupported)
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 #ifdef ENABLE_VALIDATION_LAYERS
     // TODO: fix deprecations, might need to combine with .ppEnabledExtensionNames
@@ -1050,32 +2066,50 @@ void VkBase::createLogicalDevice() {
         throw std::runtime_error("failed to create logical device!");
     }
 
+    memoryTracker.init(physicalDevice, isMemoryBudgetSupported);
+    memoryTracker.setBudgetLimit(static_cast<VkDeviceSize>(options.memoryBudgetMb) * 1024 * 1024);
+
     vkGetDeviceQueue(device, queueFamilyIndices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, queueFamilyIndices.presentFamily.value(), 0, &presentQueue);
+    if (isAsyncCompute)
+        vkGetDeviceQueue(device, queueFamilyIndices.computeFamily.value(), 0, &computeQueue);
+
+#ifndef NDEBUG
+    if (options.deformation)
+        std::cout << "Deformation: " << (isAsyncCompute ? "async compute queue family " + std::to_string(queueFamilyIndices.computeFamily.value()) : std::string("graphics queue")) << '\n';
+#endif
 }
 
-int VkBase::rateDevice(VkPhysicalDevice device, bool& isDiscrete) const {
-    VkPhysicalDeviceProperties deviceProperties = {};
-    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+// ranked, suitability depends on the surface
+void VkBase::enumerateDevices(DeviceSelector& selector) const {
+    selector.enumerate(instance, [this](VkPhysicalDevice device) {
+        VkPhysicalDeviceFeatures deviceFeatures = {};
+        vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+        return isDeviceSuitable(device, &deviceFeatures);
+    });
+}
 
-    VkPhysicalDeviceFeatures deviceFeatures = {};
-    vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+std::string VkBase::getDeviceOverride() const {
+    if (!options.device.empty())
+        return options.device;
+    const char* env = std::getenv("BEAST_DEVICE");
+    return env != nullptr ? env : "";
+}
 
-    // return early if not suitable to be used
-    if (!isDeviceSuitable(device, static_cast<const VkPhysicalDeviceFeatures*>(&deviceFeatures)))
-        return 0;
+// only instance, and surface are needed to tell which devices are suitable
+void VkBase::listDevices() {
+    createInstance();
+    setupDebugMessenger();
+    createSurface();
 
-    int score = 0;
-    if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-        score += 100;
-        isDiscrete = true;
-    }
-    else {
-        score += 30;
-        isDiscrete = false;
-    }
+    DeviceSelector selector;
+    enumerateDevices(selector);
+    const std::string deviceOverride = getDeviceOverride();
+    selector.print(selector.select(deviceOverride));
+    if (!deviceOverride.empty())
+        std::printf("Requested device: \"%s\"\n", deviceOverride.c_str());
 
-    return score;
+    cleanupInstance();
 }
 
 void VkBase::printDeviceInfo(VkPhysicalDevice& device) const {
@@ -1153,6 +2187,21 @@ std::string VkBase::getDeviceTypeString(uint32_t deviceType) const {
     }
 }
 
+std::string VkBase::getPresentModeString(VkPresentModeKHR presentMode) const {
+    switch (presentMode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "IMMEDIATE";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "MAILBOX";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "FIFO";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "FIFO_RELAXED";
+        default:
+            return "Unknown";
+    }
+}
+
 bool VkBase::isDeviceSuitable(VkPhysicalDevice device, const VkPhysicalDeviceFeatures* supportedFeatures) const {
     QueueFamilyIndices indices = findQueueFamilies(device);
     bool extensionsSupported = checkDeviceExtensionSupport(device);
@@ -1183,11 +2232,20 @@ bool VkBase::checkDeviceExtensionSupport(VkPhysicalDevice device) const {
     return requiredExtensions.empty();
 }
 
-bool VkBase::checkAllRequiredExtensionsSupported() const {
-    // get all extensions required by glfw
+// instance extensions needed to create a surface
+std::vector<const char*> VkBase::getSurfaceExtensions() const {
+    if (options.headless)
+        return { VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME };
+
     uint32_t glfwExtensionCount = 0;
     const char** glfwExtensions;
     glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    return std::vector<const char*>(glfwExtensions, glfwExtensions + glfwExtensionCount);
+}
+
+bool VkBase::checkAllRequiredExtensionsSupported() const {
+    // get all extensions required by glfw (or headless surface)
+    const std::vector<const char*> surfaceExtensions = getSurfaceExtensions();
 
     // get all extensions available from vulkan
     uint32_t extensionCount = 0;
@@ -1196,16 +2254,16 @@ bool VkBase::checkAllRequiredExtensionsSupported() const {
     vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
 
     // O(N^2) checking
-    for (int i=0; i<glfwExtensionCount; ++i) {
+    for (size_t i=0; i<surfaceExtensions.size(); ++i) {
         bool thisExtFound = false;
-        for (int j=0; j<extensionCount; ++j) {
-            if (std::strcmp(glfwExtensions[i], extensions[j].extensionName) == 0) {
+        for (uint32_t j=0; j<extensionCount; ++j) {
+            if (std::strcmp(surfaceExtensions[i], extensions[j].extensionName) == 0) {
                 thisExtFound = true;
                 break;
             }
         }
         if (!thisExtFound) {
-            std::cerr << glfwExtensions[i] << " is not supported\n";
+            std::cerr << surfaceExtensions[i] << " is not supported\n";
             return false;
         }
     }
@@ -1224,13 +2282,15 @@ VkSurfaceFormatKHR VkBase::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFo
     return availableFormats[0];
 }
 
-VkPresentModeKHR VkBase::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const {
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
-        }
-    }
+VkPresentModeKHR VkBase::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
+    if (std::find(availablePresentModes.begin(), availablePresentModes.end(), options.presentMode) != availablePresentModes.end())
+        return options.presentMode;
 
+    if (!isPresentModeFallbackReported) {
+        std::cerr << "present mode " << getPresentModeString(options.presentMode) << " is not supported, fallback to FIFO\n";
+        isPresentModeFallbackReported = true;
+    }
+    // FIFO is always supported
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -1243,7 +2303,7 @@ VkExtent2D VkBase::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities
         // window's resolution
         int width;
         int height;
-        glfwGetFramebufferSize(window, &width, &height);
+        getFramebufferSize(width, height);
 
         VkExtent2D actualExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
         actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
@@ -1279,54 +2339,799 @@ bool VkBase::checkValidationLayerSupport() const {
 }
 
 void VkBase::recreateSwapChain() {
-    vkDeviceWaitIdle(device);
+    // window is minimized, wait until it has non-zero size again
+    int width = 0;
+    int height = 0;
+    getFramebufferSize(width, height);
+    while (width == 0 || height == 0) {
+        glfwWaitEvents();
+        getFramebufferSize(width, height);
+    }
+
+    ProfileZone zone(profiler, "recreate swapchain");
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // retire in-flight frames by waiting for the last submitted frame instead of idling the whole device
+    waitTimelineSemaphore(graphicsTimeline, graphicsTimelineValue);
 
+    const size_t oldImageCount = swapChainImages.size();
     cleanupSwapChain();
 
     createSwapChain();
     createImageViews();
-    createRenderPass();
-    createGraphicsPipeline();
+
+    // viewport/scissor are dynamic, so only rebuild render pass and pipeline
+    // if surface format or sample count changed
+    if (!isRenderPassCompatible()) {
+        cleanupPipeline();
+        createRenderPass();
+        createGraphicsPipeline();
+    }
+
     createColorResources();
     createDepthResources();
     createFramebuffers();
-    createUniformBuffers();
-    createDescriptorPool();
-    createDescriptorSets();
-    createCommandBuffers();
+
+    // per-image resources only need to be rebuilt if number of swapchain images changed
+    if (swapChainImages.size() != oldImageCount) {
+        // semaphores might still be waited on by a pending present, this is a rare path so just drain the queue
+        vkQueueWaitIdle(presentQueue);
+        cleanupPerImageResources();
+        cleanupSyncObjects();
+        createUniformBuffers();
+        if (options.deformation)
+            createSkinningOutputs();
+        createDescriptorSets();
+        createCommandBuffers();
+        createSyncObjects();
+    }
+    else {
+        updateUniformBufferProjection();
+        recordCommandBuffers();
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    double elapsedMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    ++resizeStats.count;
+    resizeStats.totalMs += elapsedMs;
+    resizeStats.minMs = resizeStats.count == 1 ? elapsedMs : std::min(resizeStats.minMs, elapsedMs);
+    resizeStats.maxMs = std::max(resizeStats.maxMs, elapsedMs);
+}
+
+void VkBase::printResizeStats() const {
+    if (resizeStats.count == 0)
+        return;
+
+    std::printf("Swapchain recreation: %u time(s), avg %.3f ms, min %.3f ms, max %.3f ms\n", resizeStats.count, resizeStats.totalMs / resizeStats.count, resizeStats.minMs, resizeStats.maxMs);
+}
+
+void VkBase::printStartupStats() const {
+    std::printf("Startup (%s asset loading, %s uploads)\n", options.parallelAssetLoading ? "parallel" : "serial", options.batchUploads ? "batched" : "per operation");
+    std::printf("  window              %8.3f ms\n", startupStats.windowMs);
+    std::printf("  device              %8.3f ms\n", startupStats.deviceMs);
+    std::printf("  swapchain/pipeline  %8.3f ms\n", startupStats.swapChainMs);
+    std::printf("  wait for assets     %8.3f ms (model parse %.3f ms, texture decode %.3f ms)\n", startupStats.assetWaitMs, startupStats.modelParseMs, startupStats.textureDecodeMs);
+    std::printf("  uploads             %8.3f ms in %u submission(s)\n", startupStats.uploadMs, startupStats.uploadSubmits);
+    std::printf("  per-image resources %8.3f ms\n", startupStats.perImageMs);
+    std::printf("  pipeline stall      %8.3f ms (%.3f ms compiling on %u thread(s), %zu variant(s) pending, cache %s)\n",
+            pipelineVariants.getStallMs(), pipelineVariants.getCompileMs(), pipelineCompiler.getNumThreads(), pipelineVariants.getNumCompiling(),
+            pipelineCompiler.isCacheLoaded() ? "loaded" : "cold");
+    std::printf("  initVulkan total    %8.3f ms\n", startupStats.initMs);
+    if (isFirstFramePresented)
+        std::printf("  time to first frame %8.3f ms\n", startupStats.firstFrameMs);
+    resourceManager.printStats();
+}
+
+// programmatically resize window back and forth, and measure latency from resize request until
+// the first frame presented with the new swapchain
+void VkBase::runResizeBenchmark() {
+    const uint32_t numResizes = options.benchResizes;
+    const int maxFramesPerResize = 100;
+
+    if (options.headless) {
+        std::cerr << "Resize benchmark: there's no window to resize when headless\n";
+        return;
+    }
+
+    int baseWidth;
+    int baseHeight;
+    glfwGetWindowSize(window, &baseWidth, &baseHeight);
+
+    // warm up
+    for (int i=0; i<10; ++i) {
+        glfwPollEvents();
+        drawFrame();
+    }
+
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+    uint32_t numMeasured = 0;
+
+    for (uint32_t i=0; i<numResizes; ++i) {
+        const int delta = (i % 2 == 0) ? 64 : 0;
+        const uint32_t prevCount = resizeStats.count;
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        glfwSetWindowSize(window, baseWidth + delta, baseHeight + delta);
+
+        for (int frame=0; frame<maxFramesPerResize && resizeStats.count == prevCount; ++frame) {
+            glfwPollEvents();
+            drawFrame();
+        }
+        // one more frame rendered with new swapchain
+        glfwPollEvents();
+        drawFrame();
+        auto endTime = std::chrono::high_resolution_clock::now();
+
+        if (resizeStats.count == prevCount) {
+            std::cout << "  resize " << i << ": no swapchain recreation observed\n";
+            continue;
+        }
+
+        double elapsedMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+        totalMs += elapsedMs;
+        maxMs = std::max(maxMs, elapsedMs);
+        ++numMeasured;
+    }
+
+    vkDeviceWaitIdle(device);
+
+    std::cout << "Resize benchmark: " << numMeasured << " of " << numResizes << " resizes measured\n";
+    if (numMeasured > 0)
+        std::printf("  resize-to-present latency: avg %.3f ms, max %.3f ms\n", totalMs / numMeasured, maxMs);
+    printResizeStats();
+}
+
+void VkBase::runGeometryBenchmark() {
+    const uint32_t numOperations = options.benchGeometry;
+    const int numValidationFrames = 10;
+
+    // leftover capacity is used for churning, sizes resemble small meshes
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> vertexCountDist(16, 2048);
+    std::vector<GeometryArena::AllocationHandle> scratch;
+    uint32_t numFailed = 0;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (uint32_t i=0; i<numOperations; ++i) {
+        if (!scratch.empty() && rng() % 3 == 0) {
+            const size_t victim = rng() % scratch.size();
+            geometryArena.free(scratch[victim]);
+            scratch[victim] = scratch.back();
+            scratch.pop_back();
+            continue;
+        }
+        try {
+            const bool isVertices = rng() % 2 == 0;
+            const VkDeviceSize stride = isVertices ? sizeof(Vertex) : sizeof(uint32_t);
+            scratch.push_back(geometryArena.allocate(vertexCountDist(rng) * stride, stride));
+        }
+        catch (const std::runtime_error&) {
+            ++numFailed;
+        }
+    }
+    auto endTime = std::chrono::high_resolution_clock::now();
+    const double churnMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+    // punch holes to leave the arena fragmented
+    for (size_t i=0; i<scratch.size(); i+=2)
+        geometryArena.free(scratch[i]);
+    std::vector<GeometryArena::AllocationHandle> survivors;
+    for (size_t i=1; i<scratch.size(); i+=2)
+        survivors.push_back(scratch[i]);
+
+    std::cout << "Geometry benchmark: " << numOperations << " operations, " << numFailed << " allocation(s) out of space\n";
+    std::printf("  churn: %.3f ms (%.3f us per operation)\n", churnMs, churnMs * 1000.0 / numOperations);
+    geometryArena.printStats("fragmented");
+
+    startTime = std::chrono::high_resolution_clock::now();
+    defragmentGeometry();
+    endTime = std::chrono::high_resolution_clock::now();
+    std::printf("  defragmentation: %.3f ms (including re-recording command buffers)\n", std::chrono::duration<double, std::milli>(endTime - startTime).count());
+    geometryArena.printStats("defragmented");
+
+    for (GeometryArena::AllocationHandle handle : survivors)
+        geometryArena.free(handle);
+
+    // scene meshes were moved, render a few frames to make sure they are still drawn from right offsets
+    for (int i=0; i<numValidationFrames; ++i) {
+        pollEvents();
+        drawFrame();
+    }
+    vkDeviceWaitIdle(device);
+    std::cout << "  rendered " << numValidationFrames << " frame(s) after defragmentation\n";
 }
 
+// verify GPU skinning against CPU reference, then time both with growing number of vertices
+void VkBase::runSkinningBenchmark() {
+    const uint32_t numIterations = options.benchSkinning;
+    const int numFrames = 10;
+    const size_t vertexCounts[] = { 16 * 1024, 128 * 1024, 1024 * 1024 };
+
+    for (int i=0; i<numFrames; ++i) {
+        pollEvents();
+        drawFrame();
+    }
+    vkDeviceWaitIdle(device);
+
+    std::cout << "Skinning benchmark: " << (isAsyncCompute ? "async compute queue" : "graphics queue") << ", " << numIterations << " iteration(s)\n";
+
+    // - verification, each image rendered so far holds output of the last palette written for it
+    const std::vector<Vertex>& vertices = resourceManager.getVertices();
+    const std::vector<ResourceManager::Mesh>& meshes = resourceManager.getMeshes();
+    std::vector<Vertex> reference(vertices.size());
+
+    VkBuffer readbackBuffer;
+    VkDeviceMemory readbackBufferMemory;
+    createBuffer(geometryArena.getCapacity(), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTag::Readback, readbackBuffer, readbackBufferMemory);
+
+    float maxError = 0.0f;
+    uint32_t numVerified = 0;
+    for (size_t i=0; i<skinnedVertexBuffers.size(); ++i) {
+        if (imageTimelineValues[i] == 0)
+            continue;
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        VkMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        VkBufferCopy region = {};
+        region.size = geometryArena.getCapacity();
+        vkCmdCopyBuffer(commandBuffer, skinnedVertexBuffers[i], readbackBuffer, 1, &region);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        endSingleTimeCommands(commandBuffer);
+
+        skinVertices(vertices.data(), skinInfluences.data(), skinPalettes[i], reference.data(), vertices.size());
+
+        void* data;
+        vkMapMemory(device, readbackBufferMemory, 0, geometryArena.getCapacity(), 0, &data);
+        const Vertex* skinned = static_cast<const Vertex*>(data);
+        for (size_t m=0; m<meshes.size(); ++m) {
+            const Vertex* meshSkinned = skinned + geometryArena.getOffset(geometryMeshes[m].vertices) / sizeof(Vertex);
+            maxError = std::max(maxError, maxSkinningError(&reference[meshes[m].vertexOffset], meshSkinned, meshes[m].vertexCount));
+        }
+        vkUnmapMemory(device, readbackBufferMemory);
+        ++numVerified;
+    }
+
+    vkDestroyBuffer(device, readbackBuffer, nullptr);
+    memoryTracker.free(device, readbackBufferMemory);
+    std::printf("  verification: %u image(s), %zu vertices, max position error %g (%s)\n", numVerified, vertices.size(), maxError, maxError <= SKINNING_TOLERANCE ? "ok" : "MISMATCH");
+
+    // - scaling, scratch buffers are filled by repeating the scene's vertices
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    const bool hasTimestamps = queueFamilies[queueFamilyIndices.graphicsFamily.value()].timestampValidBits > 0;
+
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 2;
+
+    VkQueryPool queryPool;
+    if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create timestamp query pool!");
+
+    DescriptorAllocator allocator;
+    allocator.init(device);
+
+    std::printf("  %10s %12s %12s %9s\n", "vertices", "CPU ms", "GPU ms", "speedup");
+    for (size_t numVertices : vertexCounts) {
+        std::vector<Vertex> source(numVertices);
+        std::vector<SkinInfluence> influences(numVertices);
+        std::vector<Vertex> output(numVertices);
+        for (size_t v=0; v<numVertices; ++v) {
+            source[v] = vertices[v % vertices.size()];
+            influences[v] = skinInfluences[v % skinInfluences.size()];
+        }
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for (uint32_t i=0; i<numIterations; ++i)
+            skinVertices(source.data(), influences.data(), skinPalettes[0], output.data(), numVertices);
+        auto endTime = std::chrono::high_resolution_clock::now();
+        const double cpuMs = std::chrono::duration<double, std::milli>(endTime - startTime).count() / numIterations;
+
+        VkBuffer sourceBuffer, influenceBuffer, outputBuffer;
+        VkDeviceMemory sourceBufferMemory, influenceBufferMemory, outputBufferMemory;
+        createDeviceBuffer(source.data(), sizeof(Vertex) * numVertices, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryTag::Skinning, sourceBuffer, sourceBufferMemory);
+        createDeviceBuffer(influences.data(), sizeof(SkinInfluence) * numVertices, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryTag::Skinning, influenceBuffer, influenceBufferMemory);
+        createBuffer(sizeof(Vertex) * numVertices, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTag::Skinning, outputBuffer, outputBufferMemory);
+
+        VkDescriptorSet descriptorSet = allocator.allocate(skinningDescriptorSetLayout);
+        std::array<VkDescriptorBufferInfo, 4> bufferInfos = {};
+        bufferInfos[0].buffer = sourceBuffer;
+        bufferInfos[1].buffer = influenceBuffer;
+        bufferInfos[2].buffer = skinPaletteBuffers[0];
+        bufferInfos[3].buffer = outputBuffer;
+        std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
+        for (size_t b=0; b<descriptorWrites.size(); ++b) {
+            bufferInfos[b].range = VK_WHOLE_SIZE;
+            descriptorWrites[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[b].dstSet = descriptorSet;
+            descriptorWrites[b].dstBinding = static_cast<uint32_t>(b);
+            descriptorWrites[b].descriptorType = b == 2 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[b].descriptorCount = 1;
+            descriptorWrites[b].pBufferInfo = &bufferInfos[b];
+        }
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+        SkinningPushConstants pushConstants = {};
+        pushConstants.vertexCount = static_cast<uint32_t>(numVertices);
+
+        // consecutive dispatches write the same output, so they are serialized like frames would be
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        if (hasTimestamps)
+            vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, skinningPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, skinningPipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, skinningPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+        if (hasTimestamps)
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+        for (uint32_t i=0; i<numIterations; ++i) {
+            if (i > 0) {
+                VkMemoryBarrier barrier = {};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+            }
+            vkCmdDispatch(commandBuffer, (pushConstants.vertexCount + SKINNING_WORKGROUP_SIZE - 1) / SKINNING_WORKGROUP_SIZE, 1, 1);
+        }
+        if (hasTimestamps)
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+        endSingleTimeCommands(commandBuffer);
+
+        if (hasTimestamps) {
+            uint64_t timestamps[2] = {};
+            vkGetQueryPoolResults(device, queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+            const double gpuMs = (timestamps[1] - timestamps[0]) * static_cast<double>(deviceProperties.limits.timestampPeriod) / 1e6 / numIterations;
+            std::printf("  %10zu %12.3f %12.3f %8.1fx\n", numVertices, cpuMs, gpuMs, gpuMs > 0.0 ? cpuMs / gpuMs : 0.0);
+        }
+        else
+            std::printf("  %10zu %12.3f %12s %9s\n", numVertices, cpuMs, "n/a", "n/a");
+
+        vkDestroyBuffer(device, sourceBuffer, nullptr);
+        memoryTracker.free(device, sourceBufferMemory);
+        vkDestroyBuffer(device, influenceBuffer, nullptr);
+        memoryTracker.free(device, influenceBufferMemory);
+        vkDestroyBuffer(device, outputBuffer, nullptr);
+        memoryTracker.free(device, outputBufferMemory);
+    }
+
+    allocator.cleanup();
+    vkDestroyQueryPool(device, queryPool, nullptr);
+}
+
+// render the same frames with, and without depth pre-pass, and compare how many fragments got shaded
+void VkBase::runDepthPrepassBenchmark() {
+    const uint32_t numFrames = options.benchDepthPrepass;
+
+    if (!pipelineStatistics.isEnabled())
+        throw std::runtime_error("pipeline statistics queries are not supported!");
+
+    const bool wasDepthPrepassEnabled = isDepthPrepassEnabled;
+    std::cout << "Depth pre-pass benchmark: " << numFrames << " frame(s) per mode, " << msaaSamples << "x MSAA\n";
+
+    for (int mode=0; mode<2; ++mode) {
+        isDepthPrepassEnabled = mode == 1;
+        waitTimelineSemaphore(graphicsTimeline, graphicsTimelineValue);
+        // drop results of the other mode
+        collectPipelineStatistics();
+        pipelineStatistics.resetAverage();
+        recordCommandBuffers();
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for (uint32_t i=0; i<numFrames; ++i) {
+            pollEvents();
+            drawFrame();
+            // serialize frames, so every frame is measured in isolation
+            vkDeviceWaitIdle(device);
+        }
+        auto endTime = std::chrono::high_resolution_clock::now();
+        const double frameMs = std::chrono::duration<double, std::milli>(endTime - startTime).count() / numFrames;
+        collectPipelineStatistics();
+
+        std::printf("  %-16s fragment shader invocations %12llu per frame, %.3f ms per frame (serialized)\n",
+                isDepthPrepassEnabled ? "with pre-pass" : "without pre-pass", static_cast<unsigned long long>(pipelineStatistics.getAverage().fragmentShaderInvocations), frameMs);
+    }
+
+    isDepthPrepassEnabled = wasDepthPrepassEnabled;
+    recordCommandBuffers();
+}
+
+// collect results of frames which are submitted but not yet collected, GPU has to be idle
+void VkBase::collectPipelineStatistics() {
+    if (!pipelineStatistics.isEnabled())
+        return;
+    for (uint32_t image=0; image<static_cast<uint32_t>(swapChainImages.size()); ++image)
+        pipelineStatistics.collect(image, lastPipelineStatistics);
+}
+
+// render a few frames, and check statistics against what the scene has to produce.
+// meant to be run on a software ICD (e.g. lavapipe) in CI, returns non-zero on failure.
+int VkBase::runPipelineStatisticsCheck() {
+    const uint32_t numFrames = 3;
+
+    if (!pipelineStatistics.isEnabled()) {
+        std::cerr << "Pipeline statistics check: queries are not supported by this device\n";
+        return 1;
+    }
+
+    for (uint32_t i=0; i<numFrames; ++i) {
+        pollEvents();
+        drawFrame();
+    }
+    vkDeviceWaitIdle(device);
+    collectPipelineStatistics();
+
+    // every instance is drawn once, or twice with depth pre-pass; triangle lists without restart
+    const uint64_t numDraws = isDepthPrepassEnabled ? 2 : 1;
+    uint64_t numIndices = 0;
+    uint64_t numVertices = 0;
+    for (const ResourceManager::Instance& instance : resourceManager.getInstances()) {
+        const ResourceManager::Mesh& mesh = resourceManager.getMeshes()[instance.mesh];
+        numIndices += mesh.indexCount * numDraws;
+        numVertices += mesh.vertexCount * numDraws;
+    }
+
+    const PipelineStatistics::Counters& stats = lastPipelineStatistics;
+    PipelineStatistics::print("last frame", stats);
+
+    int numFailed = 0;
+    auto check = [&numFailed](const char* name, bool isPassed) {
+        std::printf("  %-48s %s\n", name, isPassed ? "PASS" : "FAIL");
+        if (!isPassed)
+            ++numFailed;
+    };
+    check("input assembly vertices == indices drawn", stats.inputAssemblyVertices == numIndices);
+    check("input assembly primitives == indices drawn / 3", stats.inputAssemblyPrimitives == numIndices / 3);
+    // post-transform cache may skip re-used vertices, but every unique vertex runs at least once
+    check("vertex shader invocations >= unique vertices", stats.vertexShaderInvocations >= numVertices);
+    check("clipping invocations <= assembled primitives", stats.clippingInvocations <= stats.inputAssemblyPrimitives);
+    check("clipping primitives > 0", stats.clippingPrimitives > 0);
+    check("fragment shader invocations > 0", stats.fragmentShaderInvocations > 0);
+
+    std::printf("Pipeline statistics check: %s\n", numFailed == 0 ? "PASS" : "FAIL");
+    return numFailed == 0 ? 0 : 1;
+}
+
+// render a few frames at fixed time, read back the last one, and compare it against golden image by PSNR;
+// run it headless on a software ICD (e.g. lavapipe) so the result doesn't depend on GPU, and driver
+int VkBase::runGoldenImageCheck() {
+    const std::string& goldenPath = options.goldenPath;
+    const uint32_t numFrames = std::max(options.goldenFrames, 2u);
+
+    if (!(querySwapChainSupport(physicalDevice).capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+        std::cerr << "Golden image check: swapchain images can't be copied from on this surface\n";
+        return 1;
+    }
+    const bool isBgra = swapChainImageFormat == VK_FORMAT_B8G8R8A8_SRGB || swapChainImageFormat == VK_FORMAT_B8G8R8A8_UNORM;
+    const bool isRgba = swapChainImageFormat == VK_FORMAT_R8G8B8A8_SRGB || swapChainImageFormat == VK_FORMAT_R8G8B8A8_UNORM;
+    if (!isBgra && !isRgba) {
+        std::cerr << "Golden image check: unsupported swapchain format " << swapChainImageFormat << '\n';
+        return 1;
+    }
+
+    // one readback buffer per swapchain's image, written by its command buffer
+    const VkExtent2D extent = swapChainExtent;
+    const VkDeviceSize imageSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+    readbackBuffers.resize(swapChainImages.size());
+    readbackBuffersMemory.resize(swapChainImages.size());
+    for (size_t i=0; i<readbackBuffers.size(); ++i)
+        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTag::Readback, readbackBuffers[i], readbackBuffersMemory[i]);
+    waitTimelineSemaphore(graphicsTimeline, graphicsTimelineValue);
+    recordCommandBuffers();
+
+    // first frame is left out of timing, it pays for lazy driver work
+    pollEvents();
+    drawFrame();
+    double maxFrameMs = 0.0;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (uint32_t i=1; i<numFrames; ++i) {
+        auto frameStart = std::chrono::high_resolution_clock::now();
+        pollEvents();
+        drawFrame();
+        auto frameEnd = std::chrono::high_resolution_clock::now();
+        maxFrameMs = std::max(maxFrameMs, std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+    }
+    waitTimelineSemaphore(graphicsTimeline, graphicsTimelineValue);
+    auto endTime = std::chrono::high_resolution_clock::now();
+    const double avgFrameMs = std::chrono::duration<double, std::milli>(endTime - startTime).count() / (numFrames - 1);
+
+    // the most recently submitted image holds the last frame
+    size_t lastImage = 0;
+    for (size_t i=1; i<imageTimelineValues.size(); ++i) {
+        if (imageTimelineValues[i] > imageTimelineValues[lastImage])
+            lastImage = i;
+    }
+
+    GoldenImage actual;
+    actual.width = extent.width;
+    actual.height = extent.height;
+    actual.pixels.resize(static_cast<size_t>(imageSize));
+    void* data;
+    vkMapMemory(device, readbackBuffersMemory[lastImage], 0, imageSize, 0, &data);
+    const uint8_t* source = static_cast<const uint8_t*>(data);
+    for (size_t p=0; p<actual.pixels.size(); p+=4) {
+        actual.pixels[p + 0] = source[p + (isBgra ? 2 : 0)];
+        actual.pixels[p + 1] = source[p + 1];
+        actual.pixels[p + 2] = source[p + (isBgra ? 0 : 2)];
+        actual.pixels[p + 3] = 255;     // composited opaque
+    }
+    vkUnmapMemory(device, readbackBuffersMemory[lastImage]);
+
+    // swapchain isn't recreated while headless, but a window might have been resized meanwhile
+    const bool isExtentKept = swapChainExtent.width == extent.width && swapChainExtent.height == extent.height;
+    for (size_t i=0; i<readbackBuffers.size(); ++i) {
+        vkDestroyBuffer(device, readbackBuffers[i], nullptr);
+        memoryTracker.free(device, readbackBuffersMemory[i]);
+    }
+    readbackBuffers.clear();
+    readbackBuffersMemory.clear();
+    recordCommandBuffers();
+
+    std::printf("Golden image check: %ux%u, %u frame(s) at %.3f s, %.3f ms/frame on average, %.3f ms at most\n",
+            extent.width, extent.height, numFrames, options.fixedTime, avgFrameMs, maxFrameMs);
+    if (!isExtentKept) {
+        std::cerr << "Golden image check: swapchain was resized while rendering\n";
+        return 1;
+    }
+
+    if (options.goldenUpdate) {
+        if (!actual.save(goldenPath)) {
+            std::cerr << "Golden image check: failed to write " << goldenPath << '\n';
+            return 1;
+        }
+        std::printf("Golden image check: wrote %s\n", goldenPath.c_str());
+        return 0;
+    }
+
+    GoldenImage golden;
+    if (!golden.load(goldenPath)) {
+        std::cerr << "Golden image check: failed to load " << goldenPath << ", create it with --golden-update\n";
+        return 1;
+    }
+
+    int numFailed = 0;
+    auto check = [&numFailed](const char* name, bool isPassed) {
+        std::printf("  %-48s %s\n", name, isPassed ? "PASS" : "FAIL");
+        if (!isPassed)
+            ++numFailed;
+    };
+    char name[64];
+    const bool isSizeMatched = golden.width == actual.width && golden.height == actual.height;
+    std::snprintf(name, sizeof(name), "size == golden (%ux%u)", golden.width, golden.height);
+    check(name, isSizeMatched);
+    if (isSizeMatched) {
+        const double psnr = GoldenImage::computePsnr(golden, actual);
+        std::snprintf(name, sizeof(name), "PSNR %.2f dB >= %.2f dB", psnr, options.goldenMinPsnr);
+        check(name, psnr >= options.goldenMinPsnr);
+    }
+    if (options.goldenMaxFrameMs > 0.0) {
+        std::snprintf(name, sizeof(name), "average frame time <= %.3f ms", options.goldenMaxFrameMs);
+        check(name, avgFrameMs <= options.goldenMaxFrameMs);
+    }
+
+    // keep what was rendered next to golden image for inspection
+    if (numFailed > 0) {
+        const std::string actualPath = goldenPath + ".actual.png";
+        if (actual.save(actualPath))
+            std::printf("Golden image check: rendered image written to %s\n", actualPath.c_str());
+    }
+
+    std::printf("Golden image check: %s\n", numFailed == 0 ? "PASS" : "FAIL");
+    return numFailed == 0 ? 0 : 1;
+}
+
+// FNV-1a over every draw, replay has to record the same command buffers as capture did
+uint64_t VkBase::computeDrawHash() const {
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i=0; i<size; ++i)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+    };
+
+    const std::vector<ResourceManager::Mesh>& meshes = resourceManager.getMeshes();
+    for (const ResourceManager::Instance& instance : resourceManager.getInstances()) {
+        add(&instance.mesh, sizeof(instance.mesh));
+        add(&instance.material, sizeof(instance.material));
+        add(&instance.transform[0][0], sizeof(float) * 16);
+        add(&meshes[instance.mesh].indexCount, sizeof(meshes[instance.mesh].indexCount));
+        add(&meshes[instance.mesh].vertexCount, sizeof(meshes[instance.mesh].vertexCount));
+    }
+    return hash;
+}
+
+FrameCapture::Settings VkBase::getCaptureSettings() const {
+    FrameCapture::Settings settings;
+    settings.width = swapChainExtent.width;
+    settings.height = swapChainExtent.height;
+    settings.msaaSamples = static_cast<uint32_t>(msaaSamples);
+    settings.sampleShading = isSampleShadingEnabled;
+    return settings;
+}
+
+void VkBase::startCapture() {
+    FrameCapture::Header header;
+    header.scenePath = options.scenePath;
+    header.swapChainImageCount = static_cast<uint32_t>(swapChainImages.size());
+    header.depthPrepass = isDepthPrepassEnabled;
+    header.deformation = options.deformation;
+    header.asyncCompute = isAsyncCompute;
+    header.drawHash = computeDrawHash();
+    header.settings = getCaptureSettings();
+
+    if (frameCapture.openWrite(options.capturePath, header))
+        std::cout << "Frame capture: recording to " << options.capturePath << '\n';
+    else
+        std::cerr << "Frame capture: failed to open " << options.capturePath << '\n';
+}
+
+// re-execute captured frames back to back, with neither window, input, nor animation on CPU, so what's
+// measured is mostly submission, and GPU/driver throughput
+int VkBase::runReplay() {
+    if (computeDrawHash() != replayHeader.drawHash) {
+        std::cerr << "Replay: draws differ from capture, it needs the same scene, and assets\n";
+        return 1;
+    }
+
+    FrameCapture::Settings settings = replayHeader.settings;
+    FrameCapture::Settings appliedSettings = settings;
+    double cpuMs = 0.0;
+    double maxFrameMs = 0.0;
+    uint32_t numFrames = 0;
+    isReplaying = true;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    while (frameCapture.readFrame(settings, replayFrame)) {
+        // captured resize, or quality change (sample count is clamped to what this device supports)
+        if (settings != appliedSettings) {
+            if (settings.width != appliedSettings.width || settings.height != appliedSettings.height) {
+                headlessExtent = { settings.width, settings.height };
+                recreateSwapChain();
+            }
+            if (settings.msaaSamples != appliedSettings.msaaSamples || settings.sampleShading != appliedSettings.sampleShading) {
+                msaaSamples = std::min(static_cast<VkSampleCountFlagBits>(settings.msaaSamples), getMaxUsableSampleCount());
+                isSampleShadingEnabled = settings.sampleShading;
+                applyQualitySettings();
+            }
+            appliedSettings = settings;
+        }
+
+        auto frameStart = std::chrono::high_resolution_clock::now();
+        drawFrame();
+        auto frameEnd = std::chrono::high_resolution_clock::now();
+        const double frameMs = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+        cpuMs += frameMs;
+        maxFrameMs = std::max(maxFrameMs, frameMs);
+        ++numFrames;
+    }
+    waitTimelineSemaphore(graphicsTimeline, graphicsTimelineValue);
+    auto endTime = std::chrono::high_resolution_clock::now();
+    isReplaying = false;
+
+    if (numFrames == 0) {
+        std::cerr << "Replay: " << options.replayPath << " has no frames\n";
+        return 1;
+    }
+    const double totalMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    std::printf("Replay: %u frame(s) from %s (%llu bytes), %ux%u, %ux MSAA\n", numFrames, options.replayPath.c_str(),
+            static_cast<unsigned long long>(frameCapture.getNumBytes()), appliedSettings.width, appliedSettings.height, static_cast<uint32_t>(msaaSamples));
+    std::printf("  total %.3f ms, %.3f ms/frame (%.1f FPS)\n", totalMs, totalMs / numFrames, numFrames * 1000.0 / totalMs);
+    std::printf("  drawFrame() %.3f ms/frame on average, %.3f ms at most\n", cpuMs / numFrames, maxFrameMs);
+    return 0;
+}
+
+// destroy resources which depend on swapchain's extent
 void VkBase::cleanupSwapChain() {
+    cleanupRenderTargets();
+
+    for (size_t i=0; i<swapChainImageViews.size(); ++i)
+        vkDestroyImageView(device, swapChainImageViews[i], nullptr);
+}
+
+// destroy resources which depend on swapchain's extent, and sample count
+void VkBase::cleanupRenderTargets() {
     vkDestroyImageView(device, colorImageView, nullptr);
     vkDestroyImage(device, colorImage, nullptr);
-    vkFreeMemory(device, colorImageMemory, nullptr);
+    memoryTracker.free(device, colorImageMemory);
 
     vkDestroyImageView(device, depthImageView, nullptr);
     vkDestroyImage(device, depthImage, nullptr);
-    vkFreeMemory(device, depthImageMemory, nullptr);
+    memoryTracker.free(device, depthImageMemory);
 
     for (size_t i=0; i<swapChainFramebuffers.size(); ++i)
         vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
+}
 
-    vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+// rebuild render targets, and pipelines for current MSAA/sample shading, swapchain, and per-image resources are kept
+void VkBase::applyQualitySettings() {
+    ProfileZone zone(profiler, "apply quality settings");
+    auto startTime = std::chrono::high_resolution_clock::now();
 
-    vkDestroyPipeline(device, graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-    vkDestroyRenderPass(device, renderPass, nullptr);
+    // only frames in flight have to retire, no device idle
+    waitTimelineSemaphore(graphicsTimeline, graphicsTimelineValue);
 
-    for (size_t i=0; i<swapChainImageViews.size(); ++i)
-        vkDestroyImageView(device, swapChainImageViews[i], nullptr);
+    // sample shading is pipeline state, render pass only depends on sample count but is cheap to rebuild along
+    cleanupPipeline();
+    createRenderPass();
+    createGraphicsPipeline();
 
-    for (size_t i=0; i<swapChainImages.size(); ++i) {
+    cleanupRenderTargets();
+    createColorResources();
+    createDepthResources();
+    createFramebuffers();
+    recordCommandBuffers();
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::cout << "Quality: " << msaaSamples << "x MSAA, sample shading " << (isSampleShadingEnabled ? "on" : "off")
+              << " (rebuilt in " << std::chrono::duration<double, std::milli>(endTime - startTime).count() << " ms)\n";
+#ifndef NDEBUG
+    printAttachmentFootprint();
+#endif
+}
+
+// destroy resources which are created one per swapchain's image
+void VkBase::cleanupPerImageResources() {
+    vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+
+    if (isAsyncCompute)
+        vkFreeCommandBuffers(device, computeCommandPool, static_cast<uint32_t>(computeCommandBuffers.size()), computeCommandBuffers.data());
+    pipelineStatistics.cleanup();
+    profiler.cleanupGpu();
+
+    for (size_t i=0; i<uniformBuffers.size(); ++i) {
         vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-        vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+        memoryTracker.free(device, uniformBuffersMemory[i]);
     }
 
-    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
+    for (size_t i=0; i<skinnedVertexBuffers.size(); ++i) {
+        vkDestroyBuffer(device, skinPaletteBuffers[i], nullptr);
+        memoryTracker.free(device, skinPaletteBuffersMemory[i]);
+        vkDestroyBuffer(device, skinnedVertexBuffers[i], nullptr);
+        memoryTracker.free(device, skinnedVertexBuffersMemory[i]);
+    }
+
+    // sets are re-allocated from the same (recycled) pools after recreation
+    descriptorAllocator.resetPools();
+}
+
+void VkBase::cleanupPipeline() {
+    cleanupGraphicsPipeline();
+    vkDestroyRenderPass(device, renderPass, nullptr);
+}
+
+// everything createGraphicsPipeline() creates, render pass is kept
+void VkBase::cleanupGraphicsPipeline() {
+    pipelineVariants.cleanup();
+    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+}
+
+bool VkBase::isRenderPassCompatible() const {
+    return renderPassImageFormat == swapChainImageFormat && renderPassSampleCount == msaaSamples;
 }
 
 uint32_t VkBase::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    std::optional<uint32_t> memoryType = findOptionalMemoryType(typeFilter, properties);
+    if (!memoryType.has_value())
+        throw std::runtime_error("failed to find suitable memory type!");
+    return memoryType.value();
+}
+
+std::optional<uint32_t> VkBase::findOptionalMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
     VkPhysicalDeviceMemoryProperties memProperties;
     vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
 
@@ -1335,16 +3140,24 @@ uint32_t VkBase::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags prope
         if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
             return i;
     }
-
-    throw std::runtime_error("failed to find suitable memory type!");
+    return std::nullopt;
 }
 
-void VkBase::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+void VkBase::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryTag tag, VkBuffer& buffer, VkDeviceMemory& bufferMemory, bool isSharedWithCompute) {
     VkBufferCreateInfo bufferInfo = {};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
     bufferInfo.usage = usage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    // buffers accessed by both graphics, and async compute queue are shared to avoid ownership transfers
+    uint32_t queueFamilies[] = { queueFamilyIndices.graphicsFamily.value_or(0), queueFamilyIndices.computeFamily.value_or(0) };
+    if (isSharedWithCompute && isAsyncCompute) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = queueFamilies;
+    }
+    else
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
     if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to create vertex buffer!");
@@ -1360,14 +3173,40 @@ void VkBase::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryP
     // VK_MEMORY_PROPERTY_HOST_COHERENT_BIT for no need to manually invalidate ranges to make it visible for device->host or host->device
     allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+    if (memoryTracker.allocate(device, allocInfo, tag, bufferMemory) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate vertex buffer memory!");
     }
 
     vkBindBufferMemory(device, buffer, bufferMemory, 0);   
 }
 
-void VkBase::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+// device local buffer with initial contents, staged unless device doesn't need staging buffer
+void VkBase::createDeviceBuffer(const void* contents, VkDeviceSize size, VkBufferUsageFlags usage, MemoryTag tag, VkBuffer& buffer, VkDeviceMemory& bufferMemory, bool isSharedWithCompute) {
+    if (!isNeedStagingBuffer) {
+        createBuffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, tag, buffer, bufferMemory, isSharedWithCompute);
+
+        void* data;
+        vkMapMemory(device, bufferMemory, 0, size, 0, &data);
+        std::memcpy(data, contents, static_cast<size_t>(size));
+        vkUnmapMemory(device, bufferMemory);
+        return;
+    }
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTag::Staging, stagingBuffer, stagingBufferMemory);
+
+    void* data;
+    vkMapMemory(device, stagingBufferMemory, 0, size, 0, &data);
+    std::memcpy(data, contents, static_cast<size_t>(size));
+    vkUnmapMemory(device, stagingBufferMemory);
+
+    createBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tag, buffer, bufferMemory, isSharedWithCompute);
+    copyBuffer(stagingBuffer, buffer, size);
+    releaseStagingBuffer(stagingBuffer, stagingBufferMemory);
+}
+
+bool VkBase::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, MemoryTag tag, VkImage& image, VkDeviceMemory& imageMemory, bool isStreamed) {
     VkImageCreateInfo imageInfo = {};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -1395,39 +3234,77 @@ void VkBase::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, Vk
     allocInfo.allocationSize = memRequirements.size;
     allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+    VkResult result = memoryTracker.allocate(device, allocInfo, tag, imageMemory, isStreamed);
+    if (isStreamed && result == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
+        vkDestroyImage(device, image, nullptr);
+        image = VK_NULL_HANDLE;
+        imageMemory = VK_NULL_HANDLE;
+        return false;
+    }
+    if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate image memory!");
     }
 
     vkBindImageMemory(device, image, imageMemory, 0);
+    return true;
 }
 
-void VkBase::createIndexBuffer() {
-    VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+// multisampled color, and depth are never loaded or stored, so on tile-based GPUs they can live in tile
+// memory only; lazily allocated memory is then only committed if the driver really needs it
+void VkBase::createAttachmentImage(VkSampleCountFlagBits numSamples, VkFormat format, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& imageMemory, AttachmentFootprint& footprint) {
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = swapChainExtent.width;
+    imageInfo.extent.height = swapChainExtent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    imageInfo.samples = numSamples;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (isNeedStagingBuffer) {
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        throw std::runtime_error("failed to create attachment image!");
 
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        std::memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
-        vkUnmapMemory(device, stagingBufferMemory);
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
-        copyBuffer(stagingBuffer, indexBuffer, bufferSize);
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
-    }
-    else {
-        createBuffer(bufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, indexBuffer, indexBufferMemory);
+    // desktop GPUs usually don't expose lazily allocated memory, fall back to regular device memory
+    std::optional<uint32_t> memoryType = findOptionalMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+    footprint.isLazilyAllocated = memoryType.has_value();
+    if (!memoryType.has_value())
+        memoryType = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    footprint.size = memRequirements.size;
 
-        void* data;
-        vkMapMemory(device, indexBufferMemory, 0, bufferSize, 0, &data);
-        std::memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
-        vkUnmapMemory(device, indexBufferMemory);
-    }
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = memoryType.value();
+
+    if (memoryTracker.allocate(device, allocInfo, MemoryTag::Attachment, imageMemory) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate attachment image memory!");
+
+    vkBindImageMemory(device, image, imageMemory, 0);
+}
+
+void VkBase::printAttachmentFootprint() const {
+    auto print = [this](const char* name, VkDeviceMemory memory, const AttachmentFootprint& footprint) {
+        if (memory == VK_NULL_HANDLE)
+            return;
+        // lazily allocated memory may be committed only partially, or not at all
+        VkDeviceSize committed = footprint.size;
+        if (footprint.isLazilyAllocated)
+            vkGetDeviceMemoryCommitment(device, memory, &committed);
+        std::printf("  %-8s %8.2f MB %s, %.2f MB committed\n", name, footprint.size / (1024.0 * 1024.0), footprint.isLazilyAllocated ? "lazily allocated" : "device local", committed / (1024.0 * 1024.0));
+    };
+
+    std::printf("Attachments (%ux%u, %ux MSAA)\n", swapChainExtent.width, swapChainExtent.height, static_cast<uint32_t>(msaaSamples));
+    print("color", colorImageMemory, colorFootprint);
+    print("depth", depthImageMemory, depthFootprint);
 }
 
 void VkBase::createUniformBuffers() {
@@ -1437,8 +3314,15 @@ void VkBase::createUniformBuffers() {
     uniformBuffersMemory.resize(swapChainImages.size());
 
     for (size_t i=0; i<swapChainImages.size(); ++i) {
-        createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+        createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTag::Uniform, uniformBuffers[i], uniformBuffersMemory[i]);
+    }
 
+    updateUniformBufferProjection();
+}
+
+// (re)write view, and projection matrix of all uniform buffers, needed whenever swapchain's extent changed
+void VkBase::updateUniformBufferProjection() {
+    for (size_t i=0; i<uniformBuffers.size(); ++i) {
         /*
          * initially set view, and projection matrix
          * both are infrequent update.
@@ -1456,15 +3340,25 @@ void VkBase::createUniformBuffers() {
     }
 }
 
-void VkBase::updateUniformBuffer(uint32_t currentImage) {
-    static auto startTime = std::chrono::high_resolution_clock::now();
+// in seconds since the first frame, unless fixed
+float VkBase::getAnimationTime() const {
+    if (options.fixedTime >= 0.0f)
+        return options.fixedTime;
 
+    static auto startTime = std::chrono::high_resolution_clock::now();
     auto currentTime = std::chrono::high_resolution_clock::now();
-    float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    return std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+}
 
-    // update only what necessary
-    glm::mat4 model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+FrameCapture::Frame VkBase::sampleFrameInput() const {
+    FrameCapture::Frame input;
+    input.time = getAnimationTime();
+    input.model = glm::rotate(glm::mat4(1.0f), input.time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    return input;
+}
 
+void VkBase::updateUniformBuffer(uint32_t currentImage, const glm::mat4& model) {
+    // update only what necessary
     void* data;
     vkMapMemory(device, uniformBuffersMemory[currentImage], 0, sizeof(model), 0, &data);
     std::memcpy(data, &model, sizeof(model));
@@ -1473,7 +3367,7 @@ void VkBase::updateUniformBuffer(uint32_t currentImage) {
 }
 
 void VkBase::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    VkCommandBuffer commandBuffer = beginUploadCommands();
 
     VkBufferCopy copyRegion = {};
     copyRegion.srcOffset = 0;
@@ -1481,12 +3375,10 @@ void VkBase::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize siz
     copyRegion.size = size;
     vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-    endSingleTimeCommands(commandBuffer);
+    endUploadCommands(commandBuffer);
 }
 
-void VkBase::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
+void VkBase::copyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
     VkBufferImageCopy region = {};
     region.bufferOffset = 0;
     region.bufferRowLength = 0;
@@ -1501,138 +3393,161 @@ void VkBase::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, u
     region.imageExtent = {width, height, 1};
 
     vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    endSingleTimeCommands(commandBuffer);
 }
 
-void VkBase::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    VkImageMemoryBarrier barrier = {};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = mipLevels;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
+void VkBase::createDescriptorAllocator() {
+    descriptorLayoutCache.init(device);
+    descriptorAllocator.init(device);
+}
 
-    // normal image, or depth + (optional) stencil
-    if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+void VkBase::createDescriptorSets() {
+    const std::vector<ResourceManager::Material>& materials = resourceManager.getMaterials();
+    descriptorSets.resize(swapChainImages.size() * materials.size());
+
+    // pools hold descriptors in proportion to sets allocated from them, one set per material, and skinning's per image
+    const float numSetsPerImage = static_cast<float>(materials.size() + (options.deformation ? 1 : 0));
+    DescriptorAllocator::PoolSizes poolSizes;
+    poolSizes.sizes.clear();
+    shaderReflection.addPoolSizes(0, materials.size() / numSetsPerImage, poolSizes);
+    if (options.deformation)
+        skinningShaderReflection.addPoolSizes(0, 1.0f / numSetsPerImage, poolSizes);
+    descriptorAllocator.setPoolSizes(poolSizes);
 
-        if (hasStencilComponent(format))
-            barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    for (size_t i=0; i<swapChainImages.size(); ++i) {
+        for (size_t m=0; m<materials.size(); ++m) {
+            VkDescriptorSet descriptorSet = descriptorAllocator.allocate(descriptorSetLayout);
+            descriptorSets[i * materials.size() + m] = descriptorSet;
+
+            VkDescriptorBufferInfo bufferInfo = {};
+            bufferInfo.buffer = uniformBuffers[i];
+            bufferInfo.offset = 0;
+            bufferInfo.range = sizeof(UniformBufferObject);
+
+            VkDescriptorImageInfo imageInfo = {};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfo.imageView = textures[materials[m].texture].view;
+            imageInfo.sampler = textureSampler;
+
+            std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[0].dstSet = descriptorSet;
+            descriptorWrites[0].dstBinding = 0;
+            descriptorWrites[0].dstArrayElement = 0;
+            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            descriptorWrites[0].descriptorCount = 1;
+            descriptorWrites[0].pBufferInfo = &bufferInfo;
+            descriptorWrites[0].pImageInfo = nullptr;
+            descriptorWrites[0].pTexelBufferView = nullptr;
+
+            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[1].dstSet = descriptorSet;
+            descriptorWrites[1].dstBinding = 1;
+            descriptorWrites[1].dstArrayElement = 0;
+            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            descriptorWrites[1].descriptorCount = 1;
+            descriptorWrites[1].pBufferInfo = nullptr;
+            descriptorWrites[1].pImageInfo = &imageInfo;
+            descriptorWrites[1].pTexelBufferView = nullptr;
+
+            vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+        }
     }
-    else
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 
-    // set src/dst stage masks
-    VkPipelineStageFlags srcPipelineStage;
-    VkPipelineStageFlags dstPipelineStage;
+    if (!options.deformation)
+        return;
 
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED &&
-        newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        // before transfer
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    skinningDescriptorSets.resize(swapChainImages.size());
+    for (size_t i=0; i<swapChainImages.size(); ++i) {
+        skinningDescriptorSets[i] = descriptorAllocator.allocate(skinningDescriptorSetLayout);
+
+        // binding order as in shaders/skin.comp
+        std::array<VkDescriptorBufferInfo, 4> bufferInfos = {};
+        bufferInfos[0].buffer = skinSourceBuffer;
+        bufferInfos[1].buffer = skinInfluenceBuffer;
+        bufferInfos[2].buffer = skinPaletteBuffers[i];
+        bufferInfos[3].buffer = skinnedVertexBuffers[i];
+
+        std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
+        for (size_t b=0; b<descriptorWrites.size(); ++b) {
+            bufferInfos[b].offset = 0;
+            bufferInfos[b].range = VK_WHOLE_SIZE;
+
+            descriptorWrites[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[b].dstSet = skinningDescriptorSets[i];
+            descriptorWrites[b].dstBinding = static_cast<uint32_t>(b);
+            descriptorWrites[b].dstArrayElement = 0;
+            descriptorWrites[b].descriptorType = b == 2 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[b].descriptorCount = 1;
+            descriptorWrites[b].pBufferInfo = &bufferInfos[b];
+        }
 
-        srcPipelineStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dstPipelineStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     }
-    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-             newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        // after transfer
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+}
 
-        srcPipelineStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        dstPipelineStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    }
-    else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED &&
-             (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL ||
-              newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL)) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+// stress test of descriptor allocator, allocate and write a large number of sets as if each one is
+// for a separate material/object, then reset all pools wholesale as per-frame allocation would do
+void VkBase::runDescriptorBenchmark() {
+    const uint32_t numSets = options.benchDescriptorSets;
+    const int numRounds = 10;
 
-        srcPipelineStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dstPipelineStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    }
-    else
-        throw std::runtime_error("unsupported layout transition!");
+    DescriptorAllocator allocator;
+    allocator.init(device);
 
-    vkCmdPipelineBarrier(commandBuffer, srcPipelineStage, dstPipelineStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = uniformBuffers[0];
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(UniformBufferObject);
 
-    endSingleTimeCommands(commandBuffer);
-}
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = textures[0].view;
+    imageInfo.sampler = textureSampler;
 
-void VkBase::createDescriptorPool() {
-    std::array<VkDescriptorPoolSize, 2> poolSizes = {};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
+    std::cout << "Descriptor benchmark: " << numSets << " sets x " << numRounds << " rounds\n";
 
-    VkDescriptorPoolCreateInfo poolInfo = {};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(swapChainImages.size());
+    for (int round=0; round<numRounds; ++round) {
+        auto startTime = std::chrono::high_resolution_clock::now();
 
-    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
-        throw std::runtime_error("failed to create descriptor pool!");
-}
+        for (uint32_t i=0; i<numSets; ++i) {
+            VkDescriptorSet set = allocator.allocate(descriptorSetLayout);
 
-void VkBase::createDescriptorSets() {
-    std::vector<VkDescriptorSetLayout> layouts(swapChainImages.size(), descriptorSetLayout);
+            std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[0].dstSet = set;
+            descriptorWrites[0].dstBinding = 0;
+            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            descriptorWrites[0].descriptorCount = 1;
+            descriptorWrites[0].pBufferInfo = &bufferInfo;
 
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());
-    allocInfo.pSetLayouts = layouts.data();
+            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[1].dstSet = set;
+            descriptorWrites[1].dstBinding = 1;
+            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            descriptorWrites[1].descriptorCount = 1;
+            descriptorWrites[1].pImageInfo = &imageInfo;
 
-    descriptorSets.resize(swapChainImages.size());
-    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
-        throw std::runtime_error("failed to allocate descriptor sets!");
+            vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+        }
 
-    for (size_t i=0; i<swapChainImages.size(); ++i) {
-        VkDescriptorBufferInfo bufferInfo = {};
-        bufferInfo.buffer = uniformBuffers[i];
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(UniformBufferObject);
-
-        VkDescriptorImageInfo imageInfo = {};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.imageView = textureImageView;
-        imageInfo.sampler = textureSampler;
-
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = descriptorSets[i];
-        descriptorWrites[0].dstBinding = 0;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &bufferInfo;
-        descriptorWrites[0].pImageInfo = nullptr;
-        descriptorWrites[0].pTexelBufferView = nullptr;
-
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = descriptorSets[i];
-        descriptorWrites[1].dstBinding = 1;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pBufferInfo = nullptr;
-        descriptorWrites[1].pImageInfo = &imageInfo;
-        descriptorWrites[1].pTexelBufferView = nullptr;
+        auto allocTime = std::chrono::high_resolution_clock::now();
+        allocator.resetPools();
+        auto resetTime = std::chrono::high_resolution_clock::now();
 
-        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+        double allocMs = std::chrono::duration<double, std::milli>(allocTime - startTime).count();
+        double resetMs = std::chrono::duration<double, std::milli>(resetTime - allocTime).count();
+        std::printf("  round %d: alloc+write %.3f ms (%.3f us/set), reset %.3f ms\n", round, allocMs, allocMs * 1000.0 / numSets, resetMs);
     }
+
+    // layout cache lookups should be served without creating any new layout
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (uint32_t i=0; i<numSets; ++i)
+        createDescriptorSetLayout();
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::printf("  layout cache: %u lookups %.3f ms, %zu cached layout(s)\n", numSets, std::chrono::duration<double, std::milli>(endTime - startTime).count(), descriptorLayoutCache.getNumCachedLayouts());
+
+    allocator.printStats("benchmark");
+    allocator.cleanup();
 }
 
 VkCommandBuffer VkBase::beginSingleTimeCommands() {
@@ -1661,10 +3576,72 @@ void VkBase::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
+
+    // wait for this upload only, not for everything else on the queue
+    const uint64_t uploadValue = ++uploadTimelineValue;
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &uploadValue;
+
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &uploadTimeline;
     
     vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);     // TODO: review this as barrier might be possible?
+    waitTimelineSemaphore(uploadTimeline, uploadValue);
     vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    ++startupStats.uploadSubmits;
+}
+
+void VkBase::beginUploadBatch() {
+    uploadBatch = beginSingleTimeCommands();
+}
+
+void VkBase::flushUploadBatch() {
+    // make transfer writes visible to all later use of uploaded data (in subsequent submissions)
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(uploadBatch,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr);
+
+    endSingleTimeCommands(uploadBatch);
+    uploadBatch = VK_NULL_HANDLE;
+
+    for (const auto& staging : pendingStagingBuffers) {
+        vkDestroyBuffer(device, staging.first, nullptr);
+        memoryTracker.free(device, staging.second);
+    }
+    pendingStagingBuffers.clear();
+}
+
+// record into upload batch if there's one, otherwise into a new one-time command buffer
+VkCommandBuffer VkBase::beginUploadCommands() {
+    if (uploadBatch != VK_NULL_HANDLE)
+        return uploadBatch;
+    return beginSingleTimeCommands();
+}
+
+void VkBase::endUploadCommands(VkCommandBuffer commandBuffer) {
+    if (commandBuffer != uploadBatch)
+        endSingleTimeCommands(commandBuffer);
+}
+
+// staging buffer has to outlive the upload batch that reads from it
+void VkBase::releaseStagingBuffer(VkBuffer buffer, VkDeviceMemory bufferMemory) {
+    if (uploadBatch != VK_NULL_HANDLE) {
+        pendingStagingBuffers.push_back(std::make_pair(buffer, bufferMemory));
+        return;
+    }
+
+    vkDestroyBuffer(device, buffer, nullptr);
+    memoryTracker.free(device, bufferMemory);
 }
 
 VkImageView VkBase::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) {
@@ -1694,9 +3671,8 @@ VkImageView VkBase::createImageView(VkImage image, VkFormat format, VkImageAspec
 void VkBase::createDepthResources() {
     VkFormat depthFormat = findDepthFormat(); 
 
-    createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+    createAttachmentImage(msaaSamples, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthImage, depthImageMemory, depthFootprint);
     depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
-    transitionImageLayout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
 }
 
 VkFormat VkBase::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
@@ -1730,57 +3706,9 @@ bool VkBase::hasStencilComponent(VkFormat format) {
     return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
-void VkBase::loadModel() {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
-
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str()))
-        throw std::runtime_error(warn + err);
-
-    std::unordered_map<Vertex, uint32_t> uniqueVertices;
-
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex = {};
-
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
-
-            vertex.texCoord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                attrib.texcoords[2 * index.texcoord_index + 1]
-            };
-
-            vertex.color = {1.0f, 1.0f, 1.0f};
-
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());    // value for setting at indices later
-                vertices.push_back(vertex);
-            }
-
-            indices.push_back(uniqueVertices[vertex]);
-        }
-    }
-
-#ifndef NDEBUG
-    std::cout << "size of processed vertices: " << vertices.size() << " from " << std::dec << attrib.vertices.size() << "\n";
-#endif
-}
-
-void VkBase::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
-    // check if image format supports linear blitting
-    VkFormatProperties formatProperties;
-    vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
-    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
-        throw std::runtime_error("texture image format does not support linear blitting!");
-
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
+// expects all levels in TRANSFER_DST_OPTIMAL, and leaves all of them in TRANSFER_SRC_OPTIMAL,
+// transition to shader read is done once for the whole image by the caller
+void VkBase::generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
     VkImageMemoryBarrier barrier = {};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.image = image;
@@ -1830,34 +3758,22 @@ void VkBase::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWid
                 1, &blit,
                 VK_FILTER_LINEAR);
 
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer,
-                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier);
-
         if (mipWidth > 1) mipWidth >>= 1;
         if (mipHeight > 1) mipHeight >>= 1;
     }
 
+    // last level was only written to
     barrier.subresourceRange.baseMipLevel = mipLevels - 1;
     barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
     vkCmdPipelineBarrier(commandBuffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
             0, nullptr,
             0, nullptr,
             1, &barrier);
-
-    endSingleTimeCommands(commandBuffer);
 }
 
 VkSampleCountFlagBits VkBase::getMaxUsableSampleCount() const {
@@ -1878,6 +3794,13 @@ VkSampleCountFlagBits VkBase::getMaxUsableSampleCount() const {
 void VkBase::createColorResources() {
     VkFormat colorFormat = swapChainImageFormat;
 
-    createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageMemory);
+    if (msaaSamples == VK_SAMPLE_COUNT_1_BIT) {
+        colorImage = VK_NULL_HANDLE;
+        colorImageMemory = VK_NULL_HANDLE;
+        colorImageView = VK_NULL_HANDLE;
+        return;
+    }
+
+    createAttachmentImage(msaaSamples, colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, colorImage, colorImageMemory, colorFootprint);
     colorImageView = createImageView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 }
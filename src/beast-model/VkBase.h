@@ -8,6 +8,27 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "DescriptorAllocator.h"
+#include "DeviceSelector.h"
+#include "FramePacer.h"
+#include "FrameCapture.h"
+#include "GeometryArena.h"
+#include "MemoryTracker.h"
+#include "PipelineCompiler.h"
+#include "PipelineStatistics.h"
+#include "Profiler.h"
+#include "QualityGovernor.h"
+#include "RenderGraph.h"
+#include "ResourceManager.h"
+#include "Scene.h"
+#include "ShaderLibrary.h"
+#include "ShaderReflection.h"
+#include "ShaderVariants.h"
+#include "ShaderWatcher.h"
+#include "Skinning.h"
+#include "Vertex.h"
+
+#include <chrono>
 #include <iostream>
 #include <optional>
 #include <string>
@@ -19,57 +40,6 @@
 #define ENABLE_VALIDATION_LAYERS
 #endif
 
-struct Vertex {
-    glm::vec3 pos;
-    glm::vec3 color;
-    glm::vec2 texCoord;
-
-    bool operator==(const Vertex& other) const {
-        return pos == other.pos && color == other.color && texCoord == other.texCoord;
-    }
-
-    static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription = {};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-        return bindingDescription;
-    }
-
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
-
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-        attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-        return attributeDescriptions;
-    }
-};
-
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-namespace std {
-    template<> struct hash<Vertex> {
-        size_t operator()(Vertex const& vertex) const {
-            return ((hash<glm::vec3>()(vertex.pos) ^
-                    (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                    (hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
-}
-
 // get access to extension functions
 static VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
     auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
@@ -88,11 +58,55 @@ static void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMesse
     }
 }
 
+// runtime options, usually populated from command line arguments in main()
+struct VkBaseOptions {
+    uint32_t benchDescriptorSets = 0;   // if > 0, run descriptor allocator stress benchmark with this many sets instead of main loop
+    uint32_t benchResizes = 0;          // if > 0, run window resize latency benchmark with this many resizes instead of main loop
+    uint32_t benchGeometry = 0;         // if > 0, run geometry arena churn, and defragmentation benchmark with this many operations
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR; // preferred presentation mode, fallback to FIFO if not supported
+    uint32_t swapChainImageCount = 3;   // requested number of swapchain images, clamped to what surface supports
+    bool framePacing = false;           // delay input sampling to reduce input-to-photon latency
+    double targetFrameRate = 0.0;       // frame rate for frame pacing, 0 to follow measured present interval
+    bool batchUploads = true;           // record all init-time uploads into a single submission
+    bool parallelAssetLoading = true;   // parse model, and decode texture on background threads during device setup
+    std::string scenePath;              // scene description file, empty for the single built-in model
+    bool benchStartup = false;          // report startup time then exit instead of main loop
+    bool deformation = false;           // skin vertices with a compute pass every frame
+    bool asyncCompute = true;           // run deformation on a dedicated compute queue if there is one
+    uint32_t benchSkinning = 0;         // if > 0, verify GPU skinning against CPU, and benchmark both with this many iterations
+    bool depthPrepass = false;          // depth-only pass before shading, scene file can enable it as well
+    uint32_t benchDepthPrepass = 0;     // if > 0, compare fragment shader invocations with, and without depth pre-pass over this many frames each
+    bool pipelineStatistics = false;    // query pipeline statistics every frame, reported along with FPS
+    bool checkPipelineStatistics = false;   // render a few frames, check statistics against the scene, exit status is the result
+    uint32_t msaaSamples = 0;           // 1, 2, 4 or 8, clamped to what device supports, 0 for the highest usable
+    bool sampleShading = true;          // shade more than one sample per pixel when multisampled
+    double frameBudgetMs = 0.0;         // if > 0, lower MSAA/sample shading while frames take longer than this
+    std::string tracePath;              // if not empty, record CPU/GPU trace from startup, written there at exit
+    bool memoryReport = false;          // device memory usage along with FPS, and per tag report at exit (always in debug)
+    uint32_t memoryBudgetMb = 0;        // if > 0, cap budget of device local heaps, textures over it get a fallback
+    bool hotReload = false;             // recompile shaders when their sources change, and swap pipelines in place
+    std::string shaderDirectory;        // if not empty, SPIR-V modules there override embedded ones ("shaders" with hot reload)
+    bool asyncPipelines = true;         // compile shader variants on worker threads, drawing with a fallback meanwhile
+    std::string pipelineCachePath;      // if not empty, pipeline cache is loaded from, and saved there at exit
+    bool headless = false;              // render to a headless surface without a window (VK_EXT_headless_surface)
+    float fixedTime = -1.0f;            // if >= 0, animation time in seconds instead of wall clock, for reproducible frames
+    std::string goldenPath;             // if not empty, render a few frames, compare the last one against this PNG, exit status is the result
+    bool goldenUpdate = false;          // write the golden image instead of comparing against it
+    double goldenMinPsnr = 40.0;        // lowest PSNR in dB still matching the golden image
+    uint32_t goldenFrames = 8;          // number of frames rendered before the last one is read back
+    double goldenMaxFrameMs = 0.0;      // if > 0, golden image check fails if frames take longer than this on average
+    std::string capturePath;            // if not empty, inputs of every frame are captured there until exit
+    std::string replayPath;             // if not empty, replay this capture headless as fast as possible then exit
+    std::string device;                 // index, UUID, or name of device to use, $BEAST_DEVICE if empty, best ranked if both are
+    bool listDevices = false;           // print ranked devices then exit
+};
+
 class VkBase {
 public:
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> computeFamily;  // compute without graphics, for async compute
 
         inline bool isComplete() {
             return graphicsFamily.has_value() && presentFamily.has_value();
@@ -105,32 +119,92 @@ public:
         std::vector<VkPresentModeKHR> presentModes;
     };
 
+    // ranges of a mesh within geometry arena
+    struct GeometryMesh {
+        GeometryArena::AllocationHandle vertices;
+        GeometryArena::AllocationHandle indices;
+        uint32_t indexCount;
+    };
+
+    struct Texture {
+        VkImage image;
+        VkDeviceMemory memory;
+        VkImageView view;
+        uint32_t mipLevels;
+    };
+
+    // memory backing a render target
+    struct AttachmentFootprint {
+        VkDeviceSize size = 0;
+        bool isLazilyAllocated = false;
+    };
+
+    // pipeline of each material's shader variant bound by recordDrawInstances()
+    enum class DrawPass {
+        Shade,
+        DepthPrepass,
+        DepthEqual
+    };
+
 public:
-    void init(const int width, const int height, std::string title);
-    void run();
+    void init(const int width, const int height, std::string title, const VkBaseOptions& options = VkBaseOptions());
+    int run();
 
 private:
     void initWindow(const int width, const int height, std::string title);
+    void getFramebufferSize(int& width, int& height) const;
+    void pollEvents();
     void initVulkan();
     void mainLoop();
     void drawFrame();
     void cleanup();
     void createInstance();
     std::vector<const char*> getRequiredExtensions() const;
+    std::vector<const char*> getSurfaceExtensions() const;
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData);
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
     void setupDebugMessenger();
     void createSyncObjects();
+    void cleanupSyncObjects();
+    void createTimelineSemaphores();
+    VkSemaphore createTimelineSemaphore();
+    void waitTimelineSemaphore(VkSemaphore semaphore, uint64_t value);
     void createCommandPool();
-    void createTextureImage();
-    void createTextureImageView();
+    void createTextureImages();
+    void createTextureImage(const TextureData& source, Texture& texture, bool isStreamed = true);
     void createTextureSampler();
-    void createVertexBuffer();
+    void createGeometryBuffer();
+    void defragmentGeometry();
+    void runGeometryBenchmark();
+    void createSkinningPipeline();
+    VkPipeline createSkinningComputePipeline(const std::vector<char>& code) const;
+    void createSkinningBuffers();
+    void createSkinningOutputs();
+    void updateSkinningPalette(uint32_t currentImage, float time);
+    void recordSkinningPass(VkCommandBuffer commandBuffer, size_t imageIndex);
+    void submitSkinning(uint32_t imageIndex);
+    void runSkinningBenchmark();
     void createCommandBuffers();
+    void recordCommandBuffers();
+    void recordMainPass(VkCommandBuffer commandBuffer, size_t imageIndex);
+    void recordDrawInstances(VkCommandBuffer commandBuffer, size_t imageIndex, DrawPass pass);
+    void runDepthPrepassBenchmark();
+    void collectPipelineStatistics();
+    int runPipelineStatisticsCheck();
+    int runGoldenImageCheck();
+    void startCapture();
+    int runReplay();
+    uint64_t computeDrawHash() const;
+    FrameCapture::Settings getCaptureSettings() const;
+    FrameCapture::Frame sampleFrameInput() const;
     void createFramebuffers();
     void createRenderPass();
     VkShaderModule createShaderModule(const std::vector<char>& code) const;
+    void createPipelineCompiler();
     void createGraphicsPipeline();
+    ShaderVariantCache::Creator getVariantCreator(VkShaderModule vertModule, VkShaderModule fragModule);
+    ShaderVariantCache::Pipelines createVariantPipelines(const ShaderVariant& variant, const VkSpecializationInfo& specializationInfo, VkShaderModule vertModule, VkShaderModule fragModule, VkSampleCountFlagBits samples, bool isSampleShaded);
     void createImageViews();
     void createSwapChain();
     void createSurface();
@@ -139,98 +213,209 @@ private:
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) const;
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device) const;
     void pickPhysicalDevice();
-    int rateDevice(VkPhysicalDevice device, bool& isDiscrete) const;
+    void enumerateDevices(DeviceSelector& selector) const;
+    std::string getDeviceOverride() const;
+    void listDevices();
+    void cleanupInstance();
     void printDeviceInfo(VkPhysicalDevice& device) const;
     std::string getDriverVersionString(uint32_t vendorID, uint32_t driverVersion) const;
     std::string getVendorString(uint32_t vendorID) const;
     std::string getDeviceTypeString(uint32_t deviceType) const;
+    std::string getPresentModeString(VkPresentModeKHR presentMode) const;
     bool isDeviceSuitable(VkPhysicalDevice device, const VkPhysicalDeviceFeatures* supportedFeatures) const;
     bool checkDeviceExtensionSupport(VkPhysicalDevice device) const;
     bool checkAllRequiredExtensionsSupported() const;
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) const;
-    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const;
+    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) const;
     bool checkValidationLayerSupport() const;
     void recreateSwapChain();
     void cleanupSwapChain();
+    void cleanupRenderTargets();
+    void applyQualitySettings();
+    void toggleProfiler();
+    void collectProfilerFrames();
+    void cleanupPerImageResources();
+    void printResizeStats() const;
+    void printStartupStats() const;
+    void runResizeBenchmark();
+    void cleanupPipeline();
+    void cleanupGraphicsPipeline();
+    void reloadShaders();
+    bool isRenderPassCompatible() const;
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-    void createIndexBuffer();
+    std::optional<uint32_t> findOptionalMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryTag tag, VkBuffer& buffer, VkDeviceMemory& bufferMemory, bool isSharedWithCompute = false);
+    void createDeviceBuffer(const void* contents, VkDeviceSize size, VkBufferUsageFlags usage, MemoryTag tag, VkBuffer& buffer, VkDeviceMemory& bufferMemory, bool isSharedWithCompute = false);
+    // false only if a streamed image is refused over memory budget
+    bool createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, MemoryTag tag, VkImage& image, VkDeviceMemory& imageMemory, bool isStreamed = false);
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
+    void copyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+    void reflectShaders();
     void createDescriptorSetLayout();
     void createUniformBuffers();
-    void updateUniformBuffer(uint32_t currentImage);
-    void createDescriptorPool();
+    float getAnimationTime() const;
+    void updateUniformBuffer(uint32_t currentImage, const glm::mat4& model);
+    void updateUniformBufferProjection();
+    void createDescriptorAllocator();
     void createDescriptorSets();
+    void runDescriptorBenchmark();
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+    void beginUploadBatch();
+    void flushUploadBatch();
+    VkCommandBuffer beginUploadCommands();
+    void endUploadCommands(VkCommandBuffer commandBuffer);
+    void releaseStagingBuffer(VkBuffer buffer, VkDeviceMemory bufferMemory);
     VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
     void createDepthResources();
     VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
     VkFormat findDepthFormat();
     bool hasStencilComponent(VkFormat format);
-    void loadModel();
-    void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+    void generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
     VkSampleCountFlagBits getMaxUsableSampleCount() const;
     void createColorResources();
+    void createAttachmentImage(VkSampleCountFlagBits numSamples, VkFormat format, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& imageMemory, AttachmentFootprint& footprint);
+    void printAttachmentFootprint() const;
 
 private:
-    GLFWwindow* window;
+    VkBaseOptions options;
+    Profiler profiler;                      // declared early, loader threads of resource manager record into it
+    bool profilerToggled = false;
+    bool isProfilerRecorded = false;        // command buffers write GPU timestamps
+    bool isGpuTimestampSupported = false;
+    float timestampPeriod = 1.0f;           // nanoseconds per tick
+    MemoryTracker memoryTracker;            // every device memory allocation goes through it
+    GLFWwindow* window = nullptr;
+    VkExtent2D headlessExtent = {};         // stands in for window's framebuffer size when headless
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkDevice device;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    VkQueue computeQueue = VK_NULL_HANDLE;
+    bool isAsyncCompute = false;            // deformation is submitted to computeQueue
     VkSurfaceKHR surface;
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+    VkSwapchainKHR retiredSwapChain = VK_NULL_HANDLE;  // its images may still be presented, destroyed after next acquire
     std::vector<VkImage> swapChainImages;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
+    VkPresentModeKHR swapChainPresentMode;
+    bool isPresentModeFallbackReported = false;     // once, not on every swapchain's re-creation
     std::vector<VkImageView> swapChainImageViews;
     VkRenderPass renderPass;
+    VkFormat renderPassImageFormat = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits renderPassSampleCount = VK_SAMPLE_COUNT_1_BIT;
+    ShaderLibrary shaderLibrary;
+    ShaderReflection shaderReflection;      // of main.vert, and main.frag
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout;
-    VkPipeline graphicsPipeline;
+    VkShaderModule vertShaderModule = VK_NULL_HANDLE;   // kept while pipelineVariants can create pipelines
+    VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+    PipelineCompiler pipelineCompiler;      // owns pipeline cache, threads build variants off the main thread
+    ShaderVariantCache pipelineVariants;    // created lazily per material's shader variant
+    bool isDepthPrepassEnabled = false;
+    bool isPipelineStatisticsSupported = false;
+    PipelineStatistics pipelineStatistics;
+    PipelineStatistics::Counters lastPipelineStatistics;    // of the most recently collected frame
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkCommandPool commandPool;
     std::vector<VkCommandBuffer> commandBuffers;
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> imagesInFlight;
+    std::vector<uint64_t> imageTimelineValues;    // value of graphicsTimeline signaled by last frame rendered to each swapchain's image
+    VkSemaphore graphicsTimeline;                 // signaled once per frame
+    uint64_t graphicsTimelineValue = 0;           // last value submitted to be signaled
+    VkSemaphore uploadTimeline;                   // signaled once per upload (one-time command buffer)
+    uint64_t uploadTimelineValue = 0;
+    VkSemaphore computeTimeline;                  // signaled once per frame by async compute, graphics waits on it
+    uint64_t computeTimelineValue = 0;
+    VkCommandBuffer uploadBatch = VK_NULL_HANDLE;   // valid while init-time uploads are being batched
+    std::vector<std::pair<VkBuffer, VkDeviceMemory>> pendingStagingBuffers;     // released once upload batch completes
     QueueFamilyIndices queueFamilyIndices;
     size_t currentFrame = 0;
     size_t semaphoreIndex = 0;
     std::string windowTitle;
     bool framebufferResized = false;
+    bool swapChainSettingsChanged = false;  // e.g. present mode, requires swapchain recreation
+    bool qualitySettingsChanged = false;    // MSAA or sample shading, requires render targets, and pipelines rebuilt
+    QualityGovernor qualityGovernor;
+    FramePacer framePacer;
     std::vector<Vertex> modelVertices;
     std::vector<uint32_t> modelIndices;
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
-    VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
+    GeometryArena geometryArena;            // vertices, and indices of all meshes in one buffer
+    std::vector<GeometryMesh> geometryMeshes;   // one per mesh of resource manager
     std::vector<VkBuffer> uniformBuffers;       // uniform buffer for each swapchain's image
     std::vector<VkDeviceMemory> uniformBuffersMemory;
-    VkDescriptorPool descriptorPool;
-    std::vector<VkDescriptorSet> descriptorSets;
+    std::vector<VkBuffer> readbackBuffers;      // for golden image check, rendered swapchain's image is copied there
+    std::vector<VkDeviceMemory> readbackBuffersMemory;
+    DescriptorLayoutCache descriptorLayoutCache;
+    DescriptorAllocator descriptorAllocator;
+    std::vector<VkDescriptorSet> descriptorSets;    // one per swapchain's image, and material (image * numMaterials + material)
+    VkDescriptorSetLayout skinningDescriptorSetLayout;
+    ShaderReflection skinningShaderReflection;
+    ShaderWatcher shaderWatcher;
+    VkPipelineLayout skinningPipelineLayout;
+    VkPipeline skinningPipeline;
+    VkCommandPool computeCommandPool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> computeCommandBuffers;    // one per swapchain's image, async compute only
+    std::vector<SkinInfluence> skinInfluences;      // packed the same as vertices of resource manager
+    VkBuffer skinSourceBuffer;                      // bind pose of all meshes
+    VkDeviceMemory skinSourceBufferMemory;
+    VkBuffer skinInfluenceBuffer;
+    VkDeviceMemory skinInfluenceBufferMemory;
+    std::vector<VkBuffer> skinPaletteBuffers;       // one per swapchain's image
+    std::vector<VkDeviceMemory> skinPaletteBuffersMemory;
+    std::vector<BonePalette> skinPalettes;          // last palette written to each image's buffer
+    std::vector<VkBuffer> skinnedVertexBuffers;     // one per swapchain's image, same offsets as geometry arena
+    std::vector<VkDeviceMemory> skinnedVertexBuffersMemory;
+    std::vector<VkDescriptorSet> skinningDescriptorSets;   // one per swapchain's image
     bool isNeedStagingBuffer = true;       // APU doesn't need staging buffer for better performance
-    uint32_t mipLevels;
-    VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
-    VkImageView textureImageView;
+    ResourceManager resourceManager;
+    std::vector<Texture> textures;          // one per unique texture of resource manager
     VkSampler textureSampler;
     VkImage depthImage;
     VkDeviceMemory depthImageMemory;
     VkImageView depthImageView;
     VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;   // equivalent to no multisampling
-    VkImage colorImage;
-    VkDeviceMemory colorImageMemory;
-    VkImageView colorImageView;
+    VkSampleCountFlagBits maxMsaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    bool isSampleShadingEnabled = true;
+    VkImage colorImage = VK_NULL_HANDLE;    // multisampled color, not used with 1x (renders directly to swapchain's image)
+    VkDeviceMemory colorImageMemory = VK_NULL_HANDLE;
+    VkImageView colorImageView = VK_NULL_HANDLE;
+    AttachmentFootprint colorFootprint;
+    AttachmentFootprint depthFootprint;
+
+    struct ResizeStats {
+        uint32_t count = 0;
+        double totalMs = 0.0;
+        double minMs = 0.0;
+        double maxMs = 0.0;
+    } resizeStats;
+
+    // per-phase startup timing, all in ms
+    struct StartupStats {
+        double windowMs = 0.0;
+        double deviceMs = 0.0;          // instance, surface, physical, and logical device
+        double swapChainMs = 0.0;       // swapchain, render pass, pipeline, attachments, framebuffers
+        double assetWaitMs = 0.0;       // main thread blocked waiting for model, and texture
+        double uploadMs = 0.0;          // texture, vertex and index uploads including waiting for GPU
+        double perImageMs = 0.0;        // uniform buffers, descriptor sets, command buffers, sync objects
+        double initMs = 0.0;            // whole initVulkan()
+        double firstFrameMs = 0.0;      // from init() until first frame has been presented
+        double modelParseMs = 0.0;      // on loader threads, summed over all models
+        double textureDecodeMs = 0.0;   // on loader threads, summed over all textures
+        uint32_t uploadSubmits = 0;     // number of one-time submissions (each waited on)
+    } startupStats;
+    std::chrono::steady_clock::time_point startupBegin;
+    bool isFirstFramePresented = false;
+
+    FrameCapture frameCapture;              // written with --capture, or read with --replay
+    FrameCapture::Header replayHeader;
+    FrameCapture::Frame replayFrame;        // inputs of the frame being replayed
+    bool isReplaying = false;
 
     uint32_t numRenderedFrames = 0;
     float fps = 0.0f;
@@ -1,5 +1,8 @@
 #include "VkBase.h"
 
+#include <cstdlib>
+#include <cstring>
+
 const int WIDTH = 800;
 const int HEIGHT = 600;
 
@@ -7,10 +10,202 @@ class TriangleApp : public VkBase {
     
 };
 
-int main() {
-    TriangleApp app;
-    app.init(WIDTH, HEIGHT, "Vulkan - Triangle");
-    app.run();
+static bool parsePresentMode(const char* str, VkPresentModeKHR& presentMode) {
+    if (std::strcmp(str, "fifo") == 0)
+        presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    else if (std::strcmp(str, "mailbox") == 0)
+        presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    else if (std::strcmp(str, "immediate") == 0)
+        presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    else if (std::strcmp(str, "fifo_relaxed") == 0)
+        presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    else
+        return false;
+    return true;
+}
+
+static bool parseSampleCount(const char* str, uint32_t& samples) {
+    const unsigned long value = std::strtoul(str, nullptr, 10);
+    if (value != 1 && value != 2 && value != 4 && value != 8)
+        return false;
+    samples = static_cast<uint32_t>(value);
+    return true;
+}
 
-    return 0;
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n";
+    std::cout << "  --scene <file>                load scene description (JSON) instead of the built-in model\n";
+    std::cout << "  --bench-descriptors <count>   run descriptor allocator stress benchmark with <count> sets then exit\n";
+    std::cout << "  --bench-resize <count>        resize window <count> times, report swapchain recreation latency then exit\n";
+    std::cout << "  --bench-geometry <count>      churn geometry arena with <count> operations, defragment, report then exit\n";
+    std::cout << "  --bench-skinning <count>      verify GPU skinning against CPU, time both over <count> iterations then exit\n";
+    std::cout << "  --bench-depth-prepass <count> compare fragment shader invocations with, and without depth pre-pass over <count> frames then exit\n";
+    std::cout << "  --present-mode <mode>         fifo, mailbox (default), immediate or fifo_relaxed\n";
+    std::cout << "  --image-count <count>         number of swapchain images (default 3)\n";
+    std::cout << "  --frame-pacing                delay input sampling to minimize input-to-photon latency\n";
+    std::cout << "  --target-fps <fps>            frame rate for frame pacing (default follows display)\n";
+    std::cout << "  --bench-startup               report startup time, and number of upload submissions then exit\n";
+    std::cout << "  --no-upload-batch             submit, and wait for each init-time upload separately\n";
+    std::cout << "  --serial-load                 parse model, and decode texture on main thread after device setup\n";
+    std::cout << "  --deform                      skin meshes with a compute pass every frame\n";
+    std::cout << "  --no-async-compute            record deformation into graphics command buffers even if there's a compute queue\n";
+    std::cout << "  --depth-prepass               render depth-only pass first, then shade with EQUAL depth test\n";
+    std::cout << "  --pipeline-stats              query pipeline statistics every frame, shown along with FPS\n";
+    std::cout << "  --check-pipeline-stats        check pipeline statistics of a few frames against the scene then exit\n";
+    std::cout << "  --msaa <samples>              1, 2, 4 or 8 MSAA samples, clamped to device (default highest usable)\n";
+    std::cout << "  --no-sample-shading           shade once per pixel instead of per sample when multisampled\n";
+    std::cout << "  --frame-budget <ms>           lower MSAA, and sample shading while frames take longer than <ms>\n";
+    std::cout << "  --trace <file>                record CPU/GPU timeline from startup, write Chrome trace JSON at exit\n";
+    std::cout << "  --memory-report               show device memory usage with FPS, report per allocation tag at exit\n";
+    std::cout << "  --memory-budget <MB>          cap device local memory budget, textures over it use a fallback\n";
+    std::cout << "  --hot-reload                  recompile shaders with glslc when sources change, swap pipelines without restart\n";
+    std::cout << "  --shader-dir <dir>            load SPIR-V modules from <dir> if present instead of the embedded ones\n";
+    std::cout << "  --sync-pipelines              create shader variant pipelines on main thread when first drawn\n";
+    std::cout << "  --pipeline-cache <file>       load pipeline cache from <file> if it's there, save it at exit\n";
+    std::cout << "  --headless                    render without a window to a headless surface, for checks, and benchmarks\n";
+    std::cout << "  --fixed-time <seconds>        animate as if this much time has passed, every frame\n";
+    std::cout << "  --golden <png>                compare last of a few frames at fixed time against <png> then exit\n";
+    std::cout << "  --golden-update               write rendered image to --golden file instead of comparing\n";
+    std::cout << "  --golden-psnr <dB>            lowest PSNR still matching golden image (default 40)\n";
+    std::cout << "  --golden-frames <count>       number of frames rendered for golden image check (default 8)\n";
+    std::cout << "  --golden-max-frame-ms <ms>    fail golden image check if frames take longer than <ms> on average\n";
+    std::cout << "  --capture <file>              write inputs of every frame to <file> (binary) until exit\n";
+    std::cout << "  --replay <file>               replay a capture headless as fast as possible, report throughput then exit\n";
+    std::cout << "  --device <index|uuid|name>    use this device instead of the best ranked one (or set BEAST_DEVICE)\n";
+    std::cout << "  --list-devices                print devices in order of ranking, and which one would be used then exit\n";
+    std::cout << "At runtime, press P to cycle present modes, F to toggle frame pacing, M to cycle MSAA samples, S to toggle sample shading,\n";
+    std::cout << "T to start/stop recording a trace (written to --trace file, or trace.json).\n";
+}
+
+int main(int argc, char** argv) {
+    VkBaseOptions options;
+
+    for (int i=1; i<argc; ++i) {
+        if (std::strcmp(argv[i], "--scene") == 0 && i+1 < argc) {
+            options.scenePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--bench-descriptors") == 0 && i+1 < argc) {
+            options.benchDescriptorSets = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--bench-resize") == 0 && i+1 < argc) {
+            options.benchResizes = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--bench-geometry") == 0 && i+1 < argc) {
+            options.benchGeometry = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--bench-skinning") == 0 && i+1 < argc) {
+            options.benchSkinning = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            options.deformation = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-depth-prepass") == 0 && i+1 < argc) {
+            options.benchDepthPrepass = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--present-mode") == 0 && i+1 < argc && parsePresentMode(argv[i+1], options.presentMode)) {
+            ++i;
+        }
+        else if (std::strcmp(argv[i], "--image-count") == 0 && i+1 < argc) {
+            options.swapChainImageCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--frame-pacing") == 0) {
+            options.framePacing = true;
+        }
+        else if (std::strcmp(argv[i], "--target-fps") == 0 && i+1 < argc) {
+            options.targetFrameRate = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--bench-startup") == 0) {
+            options.benchStartup = true;
+        }
+        else if (std::strcmp(argv[i], "--no-upload-batch") == 0) {
+            options.batchUploads = false;
+        }
+        else if (std::strcmp(argv[i], "--serial-load") == 0) {
+            options.parallelAssetLoading = false;
+        }
+        else if (std::strcmp(argv[i], "--depth-prepass") == 0) {
+            options.depthPrepass = true;
+        }
+        else if (std::strcmp(argv[i], "--deform") == 0) {
+            options.deformation = true;
+        }
+        else if (std::strcmp(argv[i], "--no-async-compute") == 0) {
+            options.asyncCompute = false;
+        }
+        else if (std::strcmp(argv[i], "--pipeline-stats") == 0) {
+            options.pipelineStatistics = true;
+        }
+        else if (std::strcmp(argv[i], "--check-pipeline-stats") == 0) {
+            options.checkPipelineStatistics = true;
+        }
+        else if (std::strcmp(argv[i], "--msaa") == 0 && i+1 < argc && parseSampleCount(argv[i+1], options.msaaSamples)) {
+            ++i;
+        }
+        else if (std::strcmp(argv[i], "--no-sample-shading") == 0) {
+            options.sampleShading = false;
+        }
+        else if (std::strcmp(argv[i], "--frame-budget") == 0 && i+1 < argc) {
+            options.frameBudgetMs = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--trace") == 0 && i+1 < argc) {
+            options.tracePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--memory-report") == 0) {
+            options.memoryReport = true;
+        }
+        else if (std::strcmp(argv[i], "--memory-budget") == 0 && i+1 < argc) {
+            options.memoryBudgetMb = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--hot-reload") == 0) {
+            options.hotReload = true;
+        }
+        else if (std::strcmp(argv[i], "--shader-dir") == 0 && i+1 < argc) {
+            options.shaderDirectory = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--sync-pipelines") == 0) {
+            options.asyncPipelines = false;
+        }
+        else if (std::strcmp(argv[i], "--pipeline-cache") == 0 && i+1 < argc) {
+            options.pipelineCachePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        }
+        else if (std::strcmp(argv[i], "--fixed-time") == 0 && i+1 < argc) {
+            options.fixedTime = std::strtof(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--golden") == 0 && i+1 < argc) {
+            options.goldenPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--golden-update") == 0) {
+            options.goldenUpdate = true;
+        }
+        else if (std::strcmp(argv[i], "--golden-psnr") == 0 && i+1 < argc) {
+            options.goldenMinPsnr = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--golden-frames") == 0 && i+1 < argc) {
+            options.goldenFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--golden-max-frame-ms") == 0 && i+1 < argc) {
+            options.goldenMaxFrameMs = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--capture") == 0 && i+1 < argc) {
+            options.capturePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0 && i+1 < argc) {
+            options.replayPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--device") == 0 && i+1 < argc) {
+            options.device = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--list-devices") == 0) {
+            options.listDevices = true;
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    TriangleApp app;
+    app.init(WIDTH, HEIGHT, "Vulkan - Triangle", options);
+    return app.run();
 }
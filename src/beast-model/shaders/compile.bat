@@ -4,3 +4,9 @@ rem Require glslc.exe (bundled with vulkansdk).
 rem Add vulkansdk's Bin path into your environment variable PATH.
 glslc.exe main.vert -o vert.spv
 glslc.exe main.frag -o frag.spv
+glslc.exe skin.comp -o skin.spv
+
+rem same modules as comma separated words, embedded into the binary by ShaderLibrary.cpp
+glslc.exe -mfmt=num main.vert -o vert.spv.inc
+glslc.exe -mfmt=num main.frag -o frag.spv.inc
+glslc.exe -mfmt=num skin.comp -o skin.spv.inc
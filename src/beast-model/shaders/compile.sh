@@ -2,3 +2,9 @@
 
 $VULKAN_SDK/bin/glslc main.vert -o vert.spv
 $VULKAN_SDK/bin/glslc main.frag -o frag.spv
+$VULKAN_SDK/bin/glslc skin.comp -o skin.spv
+
+# same modules as comma separated words, embedded into the binary by ShaderLibrary.cpp
+$VULKAN_SDK/bin/glslc -mfmt=num main.vert -o vert.spv.inc
+$VULKAN_SDK/bin/glslc -mfmt=num main.frag -o frag.spv.inc
+$VULKAN_SDK/bin/glslc -mfmt=num skin.comp -o skin.spv.inc
@@ -6,8 +6,21 @@ layout(location = 1) in vec2 fragTexCoord;
 
 layout(binding = 1) uniform sampler2D texSampler;
 
+// material variant, see ShaderVariants.h
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool USE_VERTEX_COLOR = false;
+layout(constant_id = 2) const bool ALPHA_TEST = false;
+layout(constant_id = 3) const float ALPHA_CUTOFF = 0.5;
+
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
+    vec4 color = vec4(1.0);
+    if (USE_TEXTURE)
+        color = texture(texSampler, fragTexCoord);
+    if (USE_VERTEX_COLOR)
+        color.rgb *= fragColor;
+    if (ALPHA_TEST && color.a < ALPHA_CUTOFF)
+        discard;
+    outColor = color;
 }
@@ -15,22 +15,41 @@ if not exist %outputDir% (
     mkdir %outputDir%
 )
 
+rem compile shader, SPIR-V is embedded into the binary so this goes first
+pushd shaders
+call compile.bat
+popd
+
 rem /Z7 will produce embedded debugging info into .obj file, although .obj files are larger
 rem but it is more convenient.
 cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. VkBase.cpp /Fo:%outputDir%\VkBase.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. DescriptorAllocator.cpp /Fo:%outputDir%\DescriptorAllocator.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. DeviceSelector.cpp /Fo:%outputDir%\DeviceSelector.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. FrameCapture.cpp /Fo:%outputDir%\FrameCapture.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. FramePacer.cpp /Fo:%outputDir%\FramePacer.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. GeometryArena.cpp /Fo:%outputDir%\GeometryArena.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. GoldenImage.cpp /Fo:%outputDir%\GoldenImage.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. MemoryTracker.cpp /Fo:%outputDir%\MemoryTracker.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. PipelineCompiler.cpp /Fo:%outputDir%\PipelineCompiler.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. PipelineStatistics.cpp /Fo:%outputDir%\PipelineStatistics.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. Profiler.cpp /Fo:%outputDir%\Profiler.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. QualityGovernor.cpp /Fo:%outputDir%\QualityGovernor.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. RenderGraph.cpp /Fo:%outputDir%\RenderGraph.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. ResourceManager.cpp /Fo:%outputDir%\ResourceManager.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. Scene.cpp /Fo:%outputDir%\Scene.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. ShaderLibrary.cpp /Fo:%outputDir%\ShaderLibrary.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. ShaderReflection.cpp /Fo:%outputDir%\ShaderReflection.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. ShaderVariants.cpp /Fo:%outputDir%\ShaderVariants.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. ShaderWatcher.cpp /Fo:%outputDir%\ShaderWatcher.obj
+cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. Skinning.cpp /Fo:%outputDir%\Skinning.obj
 cl.exe /EHsc /c /O2 /std:c++17 /W3 /Z7 /I..\..\externals\include /I. main.cpp /Fo:%outputDir%\main.obj
-link.exe %outputDir%\VkBase.obj %outputDir%\main.obj /LIBPATH:..\..\externals\lib\glfw-vs2019 /LIBPATH:..\..\externals\lib\vulkan /OUT:%outputDir%\%outName%.exe /PDB:%outputDir%\%outName%.pdb glfw3dll.lib vulkan-1.lib
+link.exe %outputDir%\VkBase.obj %outputDir%\DescriptorAllocator.obj %outputDir%\DeviceSelector.obj %outputDir%\FrameCapture.obj %outputDir%\FramePacer.obj %outputDir%\GeometryArena.obj %outputDir%\GoldenImage.obj %outputDir%\MemoryTracker.obj %outputDir%\PipelineCompiler.obj %outputDir%\PipelineStatistics.obj %outputDir%\Profiler.obj %outputDir%\QualityGovernor.obj %outputDir%\RenderGraph.obj %outputDir%\ResourceManager.obj %outputDir%\Scene.obj %outputDir%\ShaderLibrary.obj %outputDir%\ShaderReflection.obj %outputDir%\ShaderVariants.obj %outputDir%\ShaderWatcher.obj %outputDir%\Skinning.obj %outputDir%\main.obj /LIBPATH:..\..\externals\lib\glfw-vs2019 /LIBPATH:..\..\externals\lib\vulkan /OUT:%outputDir%\%outName%.exe /PDB:%outputDir%\%outName%.pdb glfw3dll.lib vulkan-1.lib
 
 rem if compile or link operation failed then quit early
 if %ERRORLEVEL% GEQ 1 (
     EXIT /B %ERRORLEVEL%
 )
 
-rem compile shader
-pushd shaders
-call compile.bat
-popd
-
 if not exist %outputDir%\glfw3.dll (
     copy /Y ..\..\externals\lib\glfw-vs2019\glfw3.dll %outputDir%\glfw3.dll
 )